@@ -0,0 +1,56 @@
+#!/bin/bash
+
+set -e
+set -u
+
+# Representative pipeline workload: a mix of short, long and UTF-8 lines run
+# through the bundled plugins as a file input, as a stream in chunks, and with
+# repeated stages (which load the .so plugins and the shared runtime).
+# build.sh pgo uses it as the training run; run_pipeline_bench.sh times it
+#
+# Usage: bench/pipeline_workload.sh <build_dir> [lines]   (from the repo root)
+# Prints the wall time of each pipeline; the pipelines' own output is dropped
+
+DIR="${1:?usage: $0 <build_dir> [lines]}"
+LINES="${2:-100000}"
+ANALYZER="$DIR/analyzer"
+
+if [ ! -x "$ANALYZER" ]; then
+    echo "Error: $ANALYZER not found - run ./build.sh first" >&2
+    exit 1
+fi
+
+INPUT=$(mktemp)
+trap 'rm -f "$INPUT"' EXIT
+
+awk -v n="$LINES" 'BEGIN {
+    srand(42);
+    for (i = 0; i < n; i++) {
+        kind = i % 10;
+        if (kind < 6) {
+            printf "line %d of the workload, some ordinary text\n", i;
+        } else if (kind < 8) {
+            len = 200 + int(rand() * 1800);
+            s = "";
+            for (j = 0; j < len; j += 10) s = s "abcdefghij";
+            print s;
+        } else if (kind < 9) {
+            print "naïve café – ünïcödé line " i " ✓";
+        } else {
+            print "repeated line";
+        }
+    }
+}' > "$INPUT"
+
+TIMEFORMAT="%3R"
+run() {
+    local name="$1"
+    shift
+    local seconds
+    seconds=$( { time "$@" > /dev/null 2>&1; } 2>&1 )
+    printf "%-28s %8ss\n" "$name" "$seconds"
+}
+
+run "file, 5 stages" "$ANALYZER" --input "$INPUT" 256 uppercaser rotator flipper expander logger
+run "file, repeated stages" "$ANALYZER" --input "$INPUT" 256 uppercaser rotator rotator flipper flipper logger logger
+run "stream, chunks of 64" sh -c 'exec "$0" --chunk-lines 64 256 uppercaser rotator flipper expander logger < "$1"' "$ANALYZER" "$INPUT"
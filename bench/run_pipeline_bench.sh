@@ -0,0 +1,27 @@
+#!/bin/bash
+
+set -e
+set -u
+
+# Builds each given build type and runs the pipeline workload on it
+# Usage: bench/run_pipeline_bench.sh [debug|release|lto|pgo ...] (default: debug release)
+TYPES=( "$@" )
+if [ ${#TYPES[@]} -eq 0 ]; then
+    TYPES=( "debug" "release" )
+fi
+
+cd "$(dirname "$0")/.."
+
+for TYPE in "${TYPES[@]}"; do
+    DIR="output/$TYPE"
+    if [ "$TYPE" = "debug" ]; then
+        DIR="output"
+    fi
+
+    ./build.sh "$TYPE" > /dev/null
+
+    echo "=============================="
+    echo "Pipeline workload: $TYPE ($DIR)"
+    echo "=============================="
+    bench/pipeline_workload.sh "$DIR"
+done
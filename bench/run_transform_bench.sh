@@ -0,0 +1,22 @@
+#!/bin/bash
+
+set -e
+set -u
+
+# Builds the plugins and the kernel benchmark, then runs it from the repo root
+# Extra arguments are passed to transform_bench, e.g. -u or -b 1048576
+PLUGINS=( "uppercaser" "rotator" "flipper" "expander" )
+
+cd "$(dirname "$0")/.."
+
+./build.sh > /dev/null
+
+gcc -std=gnu99 -Wall -Wextra -O2 \
+    -o output/transform_bench \
+    bench/transform_bench.c \
+    -ldl
+
+echo "=============================="
+echo "Transform kernel benchmark"
+echo "=============================="
+./output/transform_bench "$@" "${PLUGINS[@]}"
@@ -0,0 +1,195 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Runs each plugin's plugin_transform directly - no consumer thread, no queue -
+// over a range of line lengths, once on a buffer that stays in cache ("hot")
+// and once cycling through a pool larger than the last level cache ("stream").
+//
+// Usage: transform_bench [-u] [-b bytes_per_case] [-p plugin_dir] plugin...
+
+typedef const char* (*transform_func_t)(const char*);
+typedef const char* (*plugin_init_func_t)(int);
+typedef const char* (*plugin_fini_func_t)(void);
+
+#define STREAM_POOL_BYTES (64u << 20) // Well past any LLC, so every line comes from memory
+#define DEFAULT_BYTES_PER_CASE (64u << 20)
+#define MIN_CALLS_PER_CASE 16
+
+static const size_t line_lengths[] = {
+    0, 1, 16, 64, 256, 1024, 4096, 16384, 65536, 1 << 20, 4 << 20
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Printable ASCII, or (with -u) roughly one 2-byte and one 3-byte character per 16 bytes
+static void fill_line(char* line, size_t len, int utf8, unsigned* seed) {
+    size_t i = 0;
+    while (i < len) {
+        unsigned r = rand_r(seed);
+        if (utf8 && r % 16 == 0 && i + 2 <= len) {
+            memcpy(line + i, "\xc3\xa9", 2); // U+00E9
+            i += 2;
+        } else if (utf8 && r % 16 == 1 && i + 3 <= len) {
+            memcpy(line + i, "\xe2\x82\xac", 3); // U+20AC
+            i += 3;
+        } else {
+            line[i++] = (char)(' ' + 1 + r % 94);
+        }
+    }
+    line[len] = '\0';
+}
+
+// Lines laid out back to back; hot mode uses only the first one
+typedef struct {
+    char* data;
+    size_t stride;
+    size_t count;
+} line_pool_t;
+
+static int make_pool(line_pool_t* pool, size_t len, int streaming, int utf8) {
+    pool->stride = len + 1;
+    pool->count = 1;
+    if (streaming) {
+        pool->count = STREAM_POOL_BYTES / pool->stride;
+        if (pool->count < 2) pool->count = 2;
+    }
+
+    pool->data = malloc(pool->stride * pool->count);
+    if (!pool->data) return -1;
+
+    unsigned seed = 12345;
+    for (size_t i = 0; i < pool->count; ++i) {
+        fill_line(pool->data + i * pool->stride, len, utf8, &seed);
+    }
+    return 0;
+}
+
+static void run_case(const char* plugin, transform_func_t transform, size_t len,
+                     int streaming, int utf8, size_t bytes_per_case) {
+    line_pool_t pool;
+    if (make_pool(&pool, len, streaming, utf8) != 0) {
+        fprintf(stderr, "[ERROR] Failed to allocate %zu byte lines\n", len);
+        return;
+    }
+
+    size_t calls = bytes_per_case / (len ? len : 1);
+    if (calls < MIN_CALLS_PER_CASE) calls = MIN_CALLS_PER_CASE;
+    if (calls > 4000000) calls = 4000000;
+
+    // Warm up code paths and the allocator
+    for (size_t i = 0; i < 4 && i < calls; ++i) {
+        const char* out = transform(pool.data);
+        if (out != pool.data) free((char*)out);
+    }
+
+    uint64_t start_ns = now_ns();
+    uint64_t start_cycles = now_cycles();
+    for (size_t i = 0; i < calls; ++i) {
+        const char* line = pool.data + (i % pool.count) * pool.stride;
+        const char* out = transform(line);
+        if (out != line) free((char*)out);
+    }
+    uint64_t cycles = now_cycles() - start_cycles;
+    uint64_t elapsed = now_ns() - start_ns;
+
+    double ns_per_line = (double)elapsed / (double)calls;
+    double gb_per_s = len ? (double)len * (double)calls / (double)elapsed : 0.0;
+    double cycles_per_byte = len ? (double)cycles / ((double)len * (double)calls) : 0.0;
+
+    printf("%-12s %-7s %9zu %10zu %12.1f %9.3f %12.3f\n",
+           plugin, streaming ? "stream" : "hot", len, calls, ns_per_line, gb_per_s, cycles_per_byte);
+    fflush(stdout);
+    free(pool.data);
+}
+
+static void print_usage(void) {
+    printf("Usage: transform_bench [-u] [-b bytes_per_case] [-p plugin_dir] plugin1 [plugin2 ...]\n\n");
+    printf("  -u   Mix multibyte UTF-8 characters into the input\n");
+    printf("  -b   Input bytes to push through each case (default %u)\n", DEFAULT_BYTES_PER_CASE);
+    printf("  -p   Directory holding the plugin .so files (default output)\n");
+}
+
+int main(int argc, char** argv) {
+    int utf8 = 0;
+    size_t bytes_per_case = DEFAULT_BYTES_PER_CASE;
+    const char* plugin_dir = "output";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "ub:p:h")) != -1) {
+        switch (opt) {
+        case 'u': utf8 = 1; break;
+        case 'b': bytes_per_case = strtoull(optarg, NULL, 10); break;
+        case 'p': plugin_dir = optarg; break;
+        default: print_usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc || bytes_per_case == 0) {
+        print_usage();
+        return 1;
+    }
+
+    printf("%-12s %-7s %9s %10s %12s %9s %12s\n",
+           "plugin", "input", "line_len", "lines", "ns/line", "GB/s", "cycles/byte");
+
+    for (int p = optind; p < argc; ++p) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.so", plugin_dir, argv[p]);
+
+        void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            fprintf(stderr, "[ERROR] dlopen failed for %s: %s\n", path, dlerror());
+            return 1;
+        }
+
+        transform_func_t transform = (transform_func_t)dlsym(handle, "plugin_transform");
+        plugin_init_func_t init = (plugin_init_func_t)dlsym(handle, "plugin_init");
+        plugin_fini_func_t fini = (plugin_fini_func_t)dlsym(handle, "plugin_fini");
+        if (!transform || !init || !fini) {
+            fprintf(stderr, "[ERROR] %s does not export plugin_transform\n", path);
+            dlclose(handle);
+            return 1;
+        }
+
+        // Init only reads the plugin's configuration - no thread starts until place_work
+        const char* error = init(1);
+        if (error != NULL) {
+            fprintf(stderr, "[ERROR] Initialization failed for plugin '%s': %s\n", argv[p], error);
+            dlclose(handle);
+            return 1;
+        }
+
+        for (int streaming = 0; streaming <= 1; ++streaming) {
+            for (size_t i = 0; i < sizeof(line_lengths) / sizeof(line_lengths[0]); ++i) {
+                run_case(argv[p], transform, line_lengths[i], streaming, utf8, bytes_per_case);
+            }
+        }
+
+        fini();
+        dlclose(handle);
+    }
+
+    return 0;
+}
@@ -65,6 +65,16 @@
 
 #!/bin/bash
 
+# Usage: ./build.sh [debug|release|lto|pgo]
+#   debug    (default) unoptimized with debug info, into output/
+#   release  -O2, into output/release/
+#   lto      -O2 with link time optimization, into output/lto/
+#   pgo      -O2 guided by a profile: an instrumented build in output/pgo/
+#            runs bench/pipeline_workload.sh, then the optimized build
+#            replaces it
+# Every build type keeps its own analyzer, plugins and runtime, and its
+# analyzer loads plugins from its own directory
+
 # Colors for output
 RED='\033[0;31m'
 GREEN='\033[0;32m'
@@ -84,71 +94,185 @@ print_error() {
     echo -e "${RED}[ERROR]${NC} $1"
 }
 
-# Create output directory if it doesn't exist
-print_status "Creating output directory"
-mkdir -p output
-
-# Build main application
-print_status "Building main"
-gcc -o output/analyzer main.c -ldl -lpthread || {
-    print_error "Failed to build main application"
-    exit 1
-}
-
-# Build plugins - discover them dynamically
-print_status "Building plugins"
+build_type="${1:-debug}"
+case "$build_type" in
+    debug)   out_dir="output";     opt_flags="-g" ;;
+    release) out_dir="output/release"; opt_flags="-O2 -g" ;;
+    lto)     out_dir="output/lto"; opt_flags="-O2 -g -flto=auto" ;;
+    pgo)     out_dir="output/pgo"; opt_flags="-O2 -g" ;;
+    *)
+        print_error "Unknown build type '$build_type' (debug, release, lto or pgo)"
+        exit 1
+        ;;
+esac
 
 # Check if required infrastructure files exist first
-if [ ! -f "plugins/plugin_common.c" ]; then
-    print_error "plugins/plugin_common.c not found - required for all plugins"
-    exit 1
-fi
+for required in plugins/plugin_common.c plugins/plugin_entry.c plugins/sync/monitor.c \
+                plugins/sync/consumer_producer.c plugins/text/utf8.c \
+                plugins/cache/transform_cache.c plugins/chunk/chunk.c \
+                plugins/stats/latency_histogram.c plugins/stats/trace.c io/block_writer.c io/uring.c; do
+    if [ ! -f "$required" ]; then
+        print_error "$required not found - required for all plugins"
+        exit 1
+    fi
+done
 
-if [ ! -f "plugins/sync/monitor.c" ]; then
-    print_error "plugins/sync/monitor.c not found - required for all plugins"
-    exit 1
+# Optional decompression libraries - input in a format whose library is
+# missing is rejected at run time
+compression_flags=""
+if echo '#include <zlib.h>
+int main(void) { return zlibVersion() == 0; }' | gcc -x c - -lz -o /dev/null 2>/dev/null; then
+    compression_flags="$compression_flags -DHAVE_ZLIB -lz"
+else
+    print_warning "zlib not found - gzip input will not be supported"
+fi
+if echo '#include <zstd.h>
+int main(void) { return ZSTD_versionNumber() == 0; }' | gcc -x c - -lzstd -o /dev/null 2>/dev/null; then
+    compression_flags="$compression_flags -DHAVE_ZSTD -lzstd"
+else
+    print_warning "libzstd not found - zstd input will not be supported"
 fi
 
-if [ ! -f "plugins/sync/consumer_producer.c" ]; then
-    print_error "plugins/sync/consumer_producer.c not found - required for all plugins"
-    exit 1
+# Static tracepoints (plugins/stats/probes.h) need sys/sdt.h at build time only
+probe_flags=""
+if echo '#include <sys/sdt.h>
+int main(void) { STAP_PROBE(analyzer, check); return 0; }' | gcc -x c - -o /dev/null 2>/dev/null; then
+    probe_flags="-DHAVE_SYS_SDT_H"
+else
+    print_warning "sys/sdt.h not found - static tracepoints will be compiled out"
 fi
 
-# Build plugins actually
-plugin_count=0
-for plugin_file in plugins/*.c; do
-    # skip if glob didn't match any files
-    if [ ! -f "$plugin_file" ]; then
-        continue
-    fi
-    
-    # extract pluggin name without path and extension
-    plugin_name=$(basename "$plugin_file" .c)
-    
-    # skip plugin_common.c 
-    if [ "$plugin_name" = "plugin_common" ]; then
-        continue
-    fi
-    
-    print_status "Building plugin: $plugin_name"
-    
-    gcc -fPIC -shared -o "output/${plugin_name}.so" \
-        "$plugin_file" \
-        plugins/plugin_common.c \
-        plugins/sync/monitor.c \
-        plugins/sync/consumer_producer.c \
+# Bundled plugins are also linked into the analyzer, which finds them by name
+# before trying <dir>/<name>.so. Each plugin and its plugin_entry.c get their
+# exported symbols prefixed with the plugin name (see plugins/plugin_static.h);
+# the runtime is linked in once. The list must match
+# plugins/registry/static_registry.c
+static_plugins="logger uppercaser rotator flipper expander typewriter"
+
+# Sources of output/libplugin_runtime.so; the analyzer gets them from there
+runtime_sources="plugins/plugin_common.c plugins/sync/monitor.c plugins/sync/consumer_producer.c
+                 plugins/text/utf8.c plugins/cache/transform_cache.c plugins/chunk/chunk.c
+                 plugins/stats/latency_histogram.c plugins/stats/trace.c io/uring.c io/block_writer.c"
+analyzer_io_sources=""
+for source in io/*.c; do
+    case " $(echo $runtime_sources) " in
+        *" $source "*) ;;
+        *) analyzer_io_sources="$analyzer_io_sources $source" ;;
+    esac
+done
+trap 'rm -rf output/static_objects output/*/static_objects' EXIT
+
+# Build the analyzer, the plugin runtime and every plugin into $1 with the
+# compiler flags $2
+build_tree() {
+    local dir="$1"
+    local cflags="$2"
+
+    print_status "Creating output directory $dir"
+    mkdir -p "$dir"
+
+    # Object paths stay the same from build to build, so PGO profiles match them
+    local static_dir="$dir/static_objects"
+    mkdir -p "$static_dir"
+    local static_objects=""
+    for plugin_name in $static_plugins; do
+        for source in "plugins/${plugin_name}.c" plugins/plugin_entry.c; do
+            object="$static_dir/${plugin_name}_$(basename "$source" .c).o"
+            gcc -c $cflags -DPLUGIN_STATIC_NAME="$plugin_name" -o "$object" "$source" || {
+                print_error "Failed to build built-in plugin: $plugin_name"
+                return 1
+            }
+            static_objects="$static_objects $object"
+        done
+    done
+
+    # Plugin runtime - the queue, consumer thread, cache and chunk handling every
+    # plugin uses, built once instead of copied into each .so. The analyzer links
+    # it too, so built-in and loaded stages share one copy of it. Everything finds
+    # it next to itself (rpath $ORIGIN), so a plugin copied elsewhere in $dir still loads
+    print_status "Building plugin runtime"
+    gcc $cflags $probe_flags -fPIC -shared -o "$dir/libplugin_runtime.so" $runtime_sources \
         -ldl -lpthread || {
-        print_error "Failed to build plugin: $plugin_name"
-        exit 1
+        print_error "Failed to build plugin runtime"
+        return 1
     }
-    
-    plugin_count=$((plugin_count + 1))
-done
 
-if [ $plugin_count -eq 0 ]; then
-    print_warning "No plugins found in plugins/ directory"
-else
-    print_status "Successfully built $plugin_count plugin(s)"
+    # Build main application
+    print_status "Building main"
+    gcc $cflags -o "$dir/analyzer" -DANALYZER_STATIC_PLUGINS \
+        -DANALYZER_PLUGIN_DIR="\"$dir\"" main.c $analyzer_io_sources \
+        plugins/registry/static_registry.c \
+        $static_objects \
+        -L"$dir" -lplugin_runtime -Wl,-rpath,'$ORIGIN' \
+        $compression_flags -ldl -lpthread || {
+        print_error "Failed to build main application"
+        return 1
+    }
+
+    # Build plugins - discover them dynamically
+    print_status "Building plugins"
+
+    # Build plugins actually
+    plugin_count=0
+    for plugin_file in plugins/*.c; do
+        # skip if glob didn't match any files
+        if [ ! -f "$plugin_file" ]; then
+            continue
+        fi
+
+        # extract pluggin name without path and extension
+        plugin_name=$(basename "$plugin_file" .c)
+
+        # skip plugin_common.c and plugin_entry.c
+        if [ "$plugin_name" = "plugin_common" ] || [ "$plugin_name" = "plugin_entry" ]; then
+            continue
+        fi
+
+        print_status "Building plugin: $plugin_name"
+
+        gcc $cflags -fPIC -shared -o "$dir/${plugin_name}.so" \
+            "$plugin_file" \
+            plugins/plugin_entry.c \
+            -L"$dir" -lplugin_runtime -Wl,-rpath,'$ORIGIN' \
+            -ldl -lpthread || {
+            print_error "Failed to build plugin: $plugin_name"
+            return 1
+        }
+
+        plugin_count=$((plugin_count + 1))
+    done
+
+    if [ $plugin_count -eq 0 ]; then
+        print_warning "No plugins found in plugins/ directory"
+    else
+        print_status "Successfully built $plugin_count plugin(s)"
+    fi
+}
+
+if [ "$build_type" != "pgo" ]; then
+    build_tree "$out_dir" "$opt_flags" || exit 1
+    exit 0
 fi
 
+# PGO: instrument, train on the pipeline workload, rebuild with the profile.
+# Both builds go to the same paths: gcc names a profile after its object, and
+# ids the static functions in it by the object's path too, so a profile
+# recorded anywhere else only matches the exported functions
+profile="$PWD/$out_dir/profile"
+rm -rf "$profile"
+
+build_tree "$out_dir" "$opt_flags -fprofile-generate=$profile -fprofile-update=atomic" || exit 1
+
+print_status "Training run: bench/pipeline_workload.sh $out_dir"
+bench/pipeline_workload.sh "$out_dir" > /dev/null || {
+    print_error "PGO training run failed"
+    exit 1
+}
+if ! compgen -G "$profile/*.gcda" > /dev/null; then
+    print_error "PGO training run wrote no profile"
+    exit 1
+fi
 
+# Plugin .so files the workload never loads (typewriter, and those it only
+# runs built in) have no profile by design; partial training keeps them at -O2
+build_tree "$out_dir" "$opt_flags -fprofile-use=$profile -fprofile-partial-training -Wno-missing-profile" || exit 1
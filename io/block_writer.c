@@ -0,0 +1,211 @@
+#define _GNU_SOURCE
+#include "block_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+int block_writer_init(block_writer_t* writer, int fd, size_t buffer_size, int use_uring)
+{
+    if (writer == NULL) {
+        fprintf(stderr, "Error: block_writer_init received NULL.\n");
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = fd;
+    writer->size = buffer_size ? buffer_size : BLOCK_WRITER_BUFFER_SIZE;
+    writer->in_flight = -1;
+    writer->ring.fd = -1;
+
+    for (int i = 0; i < 2; ++i) {
+        writer->buffers[i] = malloc(writer->size);
+        if (writer->buffers[i] == NULL) {
+            free(writer->buffers[0]);
+            fprintf(stderr, "Error: Failed to allocate writer buffers.\n");
+            return -1;
+        }
+    }
+
+    if (use_uring && uring_init(&writer->ring, 4) == 0) {
+        writer->use_uring = 1;
+        struct iovec iov[2] = {
+            { writer->buffers[0], writer->size },
+            { writer->buffers[1], writer->size },
+        };
+        uring_register_buffers(&writer->ring, iov, 2);
+    }
+    return 0;
+}
+
+// Plain write() of a whole buffer
+static int write_all(block_writer_t* writer, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(writer->fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            writer->error = 1;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int submit_write(block_writer_t* writer, int index)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&writer->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    size_t done = writer->in_flight_done;
+    sqe->opcode = writer->ring.buffers_registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = writer->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(writer->buffers[index] + done);
+    sqe->len = (unsigned)(writer->len[index] - done);
+    sqe->off = (uint64_t)-1; // current file position, works for pipes and ttys too
+    sqe->buf_index = (uint16_t)index;
+    sqe->user_data = (uint64_t)index;
+    writer->in_flight = index;
+    return uring_submit(&writer->ring, 0);
+}
+
+// The ring would not take the write: finish the buffer with write() and
+// stay on plain writes from here on
+static int fall_back_to_write(block_writer_t* writer, int index)
+{
+    size_t done = writer->in_flight_done;
+    uring_destroy(&writer->ring);
+    writer->use_uring = 0;
+    writer->in_flight = -1;
+    writer->in_flight_done = 0;
+    int rc = write_all(writer, writer->buffers[index] + done, writer->len[index] - done);
+    writer->len[index] = 0;
+    return rc;
+}
+
+// Wait for the in-flight write (resubmitting the rest after a short write)
+static int wait_in_flight(block_writer_t* writer)
+{
+    while (writer->in_flight >= 0) {
+        struct io_uring_cqe cqe;
+        if (uring_wait_cqe(&writer->ring, &cqe) != 0) {
+            writer->error = 1;
+            return -1;
+        }
+
+        int index = writer->in_flight;
+        if (cqe.res < 0) {
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                if (submit_write(writer, index) != 0) return fall_back_to_write(writer, index);
+                continue;
+            }
+            writer->error = 1;
+            writer->in_flight = -1;
+            writer->len[index] = 0;
+            writer->in_flight_done = 0;
+            return -1;
+        }
+
+        writer->in_flight_done += (size_t)cqe.res;
+        if (writer->in_flight_done < writer->len[index]) {
+            if (submit_write(writer, index) != 0) return fall_back_to_write(writer, index);
+            continue;
+        }
+
+        writer->len[index] = 0;
+        writer->in_flight_done = 0;
+        writer->in_flight = -1;
+    }
+    return 0;
+}
+
+// Hand the active buffer to the kernel and switch to the other one
+static int start_active(block_writer_t* writer)
+{
+    int index = writer->active;
+    if (writer->len[index] == 0) {
+        return 0;
+    }
+
+    if (!writer->use_uring) {
+        int rc = write_all(writer, writer->buffers[index], writer->len[index]);
+        writer->len[index] = 0;
+        return rc;
+    }
+
+    if (wait_in_flight(writer) != 0) {
+        return -1;
+    }
+    if (submit_write(writer, index) != 0) {
+        return fall_back_to_write(writer, index);
+    }
+    writer->active = 1 - index;
+    return 0;
+}
+
+int block_writer_append(block_writer_t* writer, const char* data, size_t len)
+{
+    if (writer->error) {
+        return -1;
+    }
+
+    while (len > 0) {
+        int index = writer->active;
+        size_t space = writer->size - writer->len[index];
+        if (space == 0) {
+            if (start_active(writer) != 0) return -1;
+            continue;
+        }
+
+        size_t n = len < space ? len : space;
+        memcpy(writer->buffers[index] + writer->len[index], data, n);
+        writer->len[index] += n;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int block_writer_kick(block_writer_t* writer)
+{
+    if (writer->error) {
+        return -1;
+    }
+    return start_active(writer);
+}
+
+int block_writer_flush(block_writer_t* writer)
+{
+    if (writer->error) {
+        return -1;
+    }
+    if (start_active(writer) != 0) {
+        return -1;
+    }
+    return writer->use_uring ? wait_in_flight(writer) : 0;
+}
+
+int block_writer_destroy(block_writer_t* writer)
+{
+    if (writer == NULL) {
+        fprintf(stderr, "Error: block_writer_destroy received NULL.\n");
+        return -1;
+    }
+
+    int rc = block_writer_flush(writer);
+    if (writer->use_uring) {
+        uring_destroy(&writer->ring);
+        writer->use_uring = 0;
+    }
+    free(writer->buffers[0]);
+    free(writer->buffers[1]);
+    writer->buffers[0] = writer->buffers[1] = NULL;
+    return writer->error ? -1 : rc;
+}
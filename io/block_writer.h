@@ -0,0 +1,69 @@
+#ifndef BLOCK_WRITER_H
+#define BLOCK_WRITER_H
+
+#include <stddef.h>
+#include "uring.h"
+
+#define BLOCK_WRITER_BUFFER_SIZE (256 * 1024)
+
+// Batches small appends into large writes on a descriptor
+// Two buffers: one fills while the other is being written. With io_uring
+// the write is submitted asynchronously (WRITE_FIXED on registered buffers);
+// otherwise, or if the kernel lacks io_uring, a plain write() loop is used.
+// At most one write is in flight, so output order is preserved
+typedef struct
+{
+    int fd; // Output descriptor (not owned)
+    int use_uring; // Ring is set up
+    uring_t ring;
+    char* buffers[2];
+    size_t size; // Capacity of each buffer
+    size_t len[2]; // Bytes waiting in each buffer
+    int active; // Buffer being filled
+    int in_flight; // Buffer being written by the ring, -1 if none
+    size_t in_flight_done; // Bytes of the in-flight buffer already written
+    int error; // A write failed - further output is dropped
+} block_writer_t;
+
+/**
+* Initialize a writer
+* @param writer Pointer to writer structure
+* @param fd Descriptor to write to
+* @param buffer_size Capacity of each buffer, 0 for BLOCK_WRITER_BUFFER_SIZE
+* @param use_uring Try io_uring first (falls back to write() if unavailable)
+* @return 0 on success, -1 on failure
+*/
+int block_writer_init(block_writer_t* writer, int fd, size_t buffer_size, int use_uring);
+
+/**
+* Flush everything and release the writer (does not close fd)
+* @param writer Pointer to writer structure
+* @return 0 on success, -1 if any write failed
+*/
+int block_writer_destroy(block_writer_t* writer);
+
+/**
+* Append bytes, starting a write whenever a buffer fills
+* @param writer Pointer to writer structure
+* @param data Bytes to append
+* @param len Number of bytes
+* @return 0 on success, -1 on failure
+*/
+int block_writer_append(block_writer_t* writer, const char* data, size_t len);
+
+/**
+* Start writing whatever is buffered without waiting for it to complete
+* (waits only for the previous write, to keep the order)
+* @param writer Pointer to writer structure
+* @return 0 on success, -1 on failure
+*/
+int block_writer_kick(block_writer_t* writer);
+
+/**
+* Write out everything buffered and wait until it is done
+* @param writer Pointer to writer structure
+* @return 0 on success, -1 on failure
+*/
+int block_writer_flush(block_writer_t* writer);
+
+#endif // BLOCK_WRITER_H
@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include "daemon_server.h"
+#include "input_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+// One accepted connection
+typedef struct
+{
+    daemon_server_t* server;
+    int fd;
+} daemon_client_t;
+
+static int make_address(const char* path, struct sockaddr_un* address)
+{
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Error: Socket path '%s' is too long.\n", path);
+        return -1;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+// A socket file nobody listens on is left over from a daemon that died - reuse the path
+static int remove_stale_socket(const char* path, const struct sockaddr_un* address)
+{
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "Error: '%s' exists and is not a socket.\n", path);
+        return -1;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        return -1;
+    }
+    int in_use = connect(probe, (const struct sockaddr*)address, sizeof(*address)) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (in_use) {
+        fprintf(stderr, "Error: Socket '%s' is already in use.\n", path);
+        return -1;
+    }
+    return unlink(path);
+}
+
+int daemon_server_open(daemon_server_t* server, const char* path)
+{
+    if (server == NULL || path == NULL) {
+        fprintf(stderr, "Error: daemon_server_open received NULL.\n");
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->signal_fd = -1;
+
+    struct sockaddr_un address;
+    if (make_address(path, &address) != 0 || remove_stale_socket(path, &address) != 0) {
+        return -1;
+    }
+
+    server->path = strdup(path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server->path == NULL || server->listen_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Error: Cannot bind socket '%s': %s\n", path, strerror(errno));
+        daemon_server_close(server);
+        return -1;
+    }
+    if (listen(server->listen_fd, DAEMON_SERVER_BACKLOG) != 0) {
+        fprintf(stderr, "Error: Cannot listen on socket '%s': %s\n", path, strerror(errno));
+        daemon_server_close(server);
+        return -1;
+    }
+
+    // Threads created from here on inherit the mask, so the signals wait in signal_fd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    server->signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (server->signal_fd < 0) {
+        fprintf(stderr, "Error: signalfd failed: %s\n", strerror(errno));
+        daemon_server_close(server);
+        return -1;
+    }
+
+    pthread_mutex_init(&server->mutex, NULL);
+    pthread_cond_init(&server->idle, NULL);
+    return 0;
+}
+
+static int add_client(daemon_server_t* server, int fd)
+{
+    pthread_mutex_lock(&server->mutex);
+    if (server->client_count == server->client_capacity) {
+        int capacity = server->client_capacity ? server->client_capacity * 2 : 16;
+        int* grown = realloc(server->client_fds, (size_t)capacity * sizeof(*grown));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&server->mutex);
+            return -1;
+        }
+        server->client_fds = grown;
+        server->client_capacity = capacity;
+    }
+    server->client_fds[server->client_count++] = fd;
+    pthread_mutex_unlock(&server->mutex);
+    return 0;
+}
+
+static void remove_client(daemon_server_t* server, int fd)
+{
+    pthread_mutex_lock(&server->mutex);
+    for (int i = 0; i < server->client_count; ++i) {
+        if (server->client_fds[i] == fd) {
+            server->client_fds[i] = server->client_fds[--server->client_count];
+            break;
+        }
+    }
+    close(fd);
+    pthread_cond_signal(&server->idle);
+    pthread_mutex_unlock(&server->mutex);
+}
+
+static void reply(int fd, const char* message)
+{
+    size_t len = strlen(message);
+    while (len > 0) {
+        ssize_t n = send(fd, message, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return; // the client went away - nobody to tell
+        message += n;
+        len -= (size_t)n;
+    }
+}
+
+static void* client_thread(void* arg)
+{
+    daemon_client_t* client = arg;
+    daemon_server_t* server = client->server;
+    char name[32];
+    snprintf(name, sizeof(name), "fd:%d", client->fd);
+
+    size_t lines = 0;
+    const char* error = NULL;
+    input_source_t source;
+    if (input_source_open(&source, name, server->framing) != 0) {
+        error = "cannot read stream";
+    } else {
+        const char* line;
+        size_t len;
+        int rc;
+        while ((rc = input_source_next(&source, &line, &len)) > 0) {
+            // "<END>" ends this client's stream, not the pipeline
+            if (input_source_is_end(line, len)) {
+                break;
+            }
+            if (server->deliver(server->ctx, line, len) != 0) {
+                error = "pipeline rejected input";
+                break;
+            }
+            lines++;
+        }
+        if (rc < 0) {
+            error = "bad input";
+        }
+        input_source_close(&source);
+    }
+
+    // The answer promises the lines are in the pipeline, not waiting for a chunk to fill
+    if (error == NULL && server->flush && server->flush(server->ctx) != 0) {
+        error = "pipeline rejected input";
+    }
+
+    char message[96];
+    if (error == NULL) {
+        snprintf(message, sizeof(message), "OK %zu\n", lines);
+    } else {
+        snprintf(message, sizeof(message), "ERROR %s after %zu lines\n", error, lines);
+    }
+    reply(client->fd, message);
+
+    remove_client(server, client->fd);
+    free(client);
+    return NULL;
+}
+
+static void start_client(daemon_server_t* server, int fd)
+{
+    daemon_client_t* client = malloc(sizeof(*client));
+    if (client == NULL || add_client(server, fd) != 0) {
+        free(client);
+        reply(fd, "ERROR out of memory after 0 lines\n");
+        close(fd);
+        return;
+    }
+    client->server = server;
+    client->fd = fd;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, client_thread, client) != 0) {
+        reply(fd, "ERROR cannot start client thread after 0 lines\n");
+        remove_client(server, fd);
+        free(client);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+int daemon_server_run(daemon_server_t* server, input_framing_t framing,
+                      input_group_deliver_t deliver, int (*flush)(void* ctx), void* ctx)
+{
+    server->framing = framing;
+    server->deliver = deliver;
+    server->flush = flush;
+    server->ctx = ctx;
+    fprintf(stderr, "[INFO] Listening on %s\n", server->path);
+
+    int result = 0;
+    struct pollfd fds[2] = {
+        { .fd = server->listen_fd, .events = POLLIN },
+        { .fd = server->signal_fd, .events = POLLIN },
+    };
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            result = -1;
+            break;
+        }
+        if (fds[1].revents) {
+            struct signalfd_siginfo info;
+            if (read(server->signal_fd, &info, sizeof(info)) > 0) {
+                fprintf(stderr, "[INFO] Signal %u - shutting down\n", info.ssi_signo);
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE) continue;
+                fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+                result = -1;
+                break;
+            }
+            start_client(server, fd);
+        }
+    }
+
+    // No new clients; cut off the ones still sending and wait for them to answer
+    pthread_mutex_lock(&server->mutex);
+    server->stopping = 1;
+    for (int i = 0; i < server->client_count; ++i) {
+        shutdown(server->client_fds[i], SHUT_RD);
+    }
+    while (server->client_count > 0) {
+        pthread_cond_wait(&server->idle, &server->mutex);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    return result;
+}
+
+void daemon_server_close(daemon_server_t* server)
+{
+    if (server == NULL) {
+        fprintf(stderr, "Error: daemon_server_close received NULL.\n");
+        return;
+    }
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        if (server->path) unlink(server->path);
+    }
+    if (server->signal_fd >= 0) {
+        close(server->signal_fd);
+        pthread_mutex_destroy(&server->mutex);
+        pthread_cond_destroy(&server->idle);
+    }
+    free(server->client_fds);
+    free(server->path);
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->signal_fd = -1;
+}
+
+int daemon_client_run(const char* path, int in_fd)
+{
+    struct sockaddr_un address;
+    if (make_address(path, &address) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Error: Cannot connect to '%s': %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // The server may stop reading early (at "<END>") - its answer still follows
+    char buffer[64 * 1024];
+    ssize_t n;
+    int sending = 1;
+    while (sending && (n = read(in_fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Failed to read input: %s\n", strerror(errno));
+            break;
+        }
+        for (ssize_t sent = 0; sent < n;) {
+            ssize_t w = send(fd, buffer + sent, (size_t)(n - sent), MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) {
+                sending = 0;
+                break;
+            }
+            sent += w;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+
+    size_t len = 0;
+    while (len < sizeof(buffer) - 1 && (n = read(fd, buffer + len, sizeof(buffer) - 1 - len)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+    buffer[len] = '\0';
+
+    if (len == 0) {
+        fprintf(stderr, "Error: No answer from '%s'.\n", path);
+        return -1;
+    }
+    fputs(buffer, stdout);
+    return strncmp(buffer, "OK ", 3) == 0 ? 0 : -1;
+}
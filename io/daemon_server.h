@@ -0,0 +1,73 @@
+#ifndef DAEMON_SERVER_H
+#define DAEMON_SERVER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "framing.h"
+#include "input_group.h"
+
+#define DAEMON_SERVER_BACKLOG 64 // Pending connections the kernel queues
+
+// Feeds client streams from a Unix domain socket into one long running pipeline
+// Every connection gets a thread that reads it like an input (same framing,
+// compressed streams are recognized) until end of stream or its "<END>" line,
+// which ends only that client. Lines of one client reach the pipeline in order;
+// lines of different clients interleave. The client is answered with
+// "OK <lines>\n" or "ERROR <reason> after <lines> lines\n" once all of its
+// lines are in the first stage's queue
+typedef struct
+{
+    int listen_fd;
+    int signal_fd; // SIGINT / SIGTERM stop the server
+    char* path; // Socket path, unlinked on close
+    input_framing_t framing;
+    input_group_deliver_t deliver; // Same contract as for input groups
+    int (*flush)(void* ctx); // Optional - pushes out lines deliver is still holding back
+    void* ctx;
+    pthread_mutex_t mutex; // Guards the fields below
+    pthread_cond_t idle; // Signaled when a client finishes
+    int* client_fds; // Connections being read
+    int client_count;
+    int client_capacity;
+    int stopping; // No new clients; running ones are cut off
+} daemon_server_t;
+
+/**
+* Bind and listen on path, and block SIGINT/SIGTERM in the calling thread
+* Call before creating any thread, so every thread inherits the blocked mask
+* and the signals only ever reach the server
+* A stale socket file left at path is replaced; any other file is an error
+* @param server Pointer to server structure
+* @param path Socket path
+* @return 0 on success, -1 on failure
+*/
+int daemon_server_open(daemon_server_t* server, const char* path);
+
+/**
+* Accept clients until SIGINT or SIGTERM, then wait for running clients
+* Clients still sending at that point see their stream cut off
+* @param server Pointer to an opened server
+* @param framing How client streams are delimited
+* @param deliver Line callback, called from client threads
+* @param flush Called when a client's stream ends (may be NULL); 0 on success
+* @param ctx Passed to deliver and flush
+* @return 0 on a clean stop, -1 if accepting failed
+*/
+int daemon_server_run(daemon_server_t* server, input_framing_t framing,
+                      input_group_deliver_t deliver, int (*flush)(void* ctx), void* ctx);
+
+/**
+* Close the socket and remove its file
+* @param server Pointer to server structure
+*/
+void daemon_server_close(daemon_server_t* server);
+
+/**
+* Client side: send everything read from in_fd to a server and print its answer
+* @param path Socket path
+* @param in_fd Stream to send (e.g. stdin)
+* @return 0 if the server answered OK, -1 otherwise
+*/
+int daemon_client_run(const char* path, int in_fd);
+
+#endif // DAEMON_SERVER_H
@@ -0,0 +1,407 @@
+#define _GNU_SOURCE
+#include "decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// build.sh defines these when the libraries link
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define DECODER_INPUT_SIZE (64 * 1024)
+
+
+compression_t compression_detect(const unsigned char* data, size_t len)
+{
+    if (len >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (len >= 4 && data[0] == 0x28 && data[1] == 0xb5 && data[2] == 0x2f && data[3] == 0xfd) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+int compression_supported(compression_t kind)
+{
+    switch (kind) {
+    case COMPRESSION_NONE:
+        return 1;
+    case COMPRESSION_GZIP:
+#ifdef HAVE_ZLIB
+        return 1;
+#else
+        return 0;
+#endif
+    case COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+        return 1;
+#else
+        return 0;
+#endif
+    }
+    return 0;
+}
+
+const char* compression_name(compression_t kind)
+{
+    switch (kind) {
+    case COMPRESSION_GZIP: return "gzip";
+    case COMPRESSION_ZSTD: return "zstd";
+    default: return "none";
+    }
+}
+
+// Compressed bytes: the detection prefix first, then the descriptor
+// Returns bytes read, 0 at end of input, -1 on error or when stopping
+static ssize_t read_input(decoder_t* decoder, unsigned char* buffer, size_t size)
+{
+    if (decoder->prefix_len > 0) {
+        size_t n = decoder->prefix_len < size ? decoder->prefix_len : size;
+        memcpy(buffer, decoder->prefix, n);
+        memmove(decoder->prefix, decoder->prefix + n, decoder->prefix_len - n);
+        decoder->prefix_len -= n;
+        return (ssize_t)n;
+    }
+
+    while (1) {
+        // Wait for input or for decoder_stop, so a quiet pipe cannot block shutdown
+        struct pollfd fds[2] = {
+            { .fd = decoder->fd, .events = POLLIN },
+            { .fd = decoder->stop_fd, .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (fds[1].revents) {
+            return -1;
+        }
+
+        ssize_t n = read(decoder->fd, buffer, size);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        return n;
+    }
+}
+
+// Queue a full block for the consumer; takes ownership of data
+static int push_block(decoder_t* decoder, char* data, size_t len)
+{
+    pthread_mutex_lock(&decoder->mutex);
+    while (decoder->count == DECODER_QUEUE_DEPTH && !decoder->stop) {
+        pthread_cond_wait(&decoder->not_full, &decoder->mutex);
+    }
+    if (decoder->stop) {
+        pthread_mutex_unlock(&decoder->mutex);
+        free(data);
+        return -1;
+    }
+
+    int tail = (decoder->head + decoder->count) % DECODER_QUEUE_DEPTH;
+    decoder->blocks[tail].data = data;
+    decoder->blocks[tail].len = len;
+    decoder->count++;
+    pthread_cond_signal(&decoder->not_empty);
+    pthread_mutex_unlock(&decoder->mutex);
+    return 0;
+}
+
+static void finish(decoder_t* decoder, int error)
+{
+    pthread_mutex_lock(&decoder->mutex);
+    decoder->done = 1;
+    decoder->error = error;
+    pthread_cond_broadcast(&decoder->not_empty);
+    pthread_mutex_unlock(&decoder->mutex);
+}
+
+// Hand over the block being filled once it is full; returns the block to continue in
+static char* emit_if_full(decoder_t* decoder, char* out, size_t* out_len)
+{
+    if (*out_len < DECODER_BLOCK_SIZE) {
+        return out;
+    }
+    if (push_block(decoder, out, *out_len) != 0) {
+        return NULL;
+    }
+    *out_len = 0;
+    return malloc(DECODER_BLOCK_SIZE);
+}
+
+// Before waiting on a quiet pipe, hand over what has been decoded so far, so
+// interactive input is not held back until a block fills up. Files are always
+// readable and keep producing full blocks
+static char* emit_before_wait(decoder_t* decoder, char* out, size_t* out_len)
+{
+    if (*out_len == 0 || decoder->prefix_len > 0) {
+        return out;
+    }
+    struct pollfd fd = { .fd = decoder->fd, .events = POLLIN };
+    if (poll(&fd, 1, 0) > 0) {
+        return out;
+    }
+    if (push_block(decoder, out, *out_len) != 0) {
+        return NULL;
+    }
+    *out_len = 0;
+    return malloc(DECODER_BLOCK_SIZE);
+}
+
+#ifdef HAVE_ZLIB
+static int decode_gzip(decoder_t* decoder, unsigned char* in, char** out, size_t* out_len)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) { // 32: accept gzip and zlib headers
+        return -1;
+    }
+
+    int status = 0;
+    int member_ended = 0;
+    while (1) {
+        if (strm.avail_in == 0) {
+            *out = emit_before_wait(decoder, *out, out_len);
+            if (*out == NULL) {
+                status = -1;
+                break;
+            }
+            ssize_t n = read_input(decoder, in, DECODER_INPUT_SIZE);
+            if (n < 0) {
+                status = -1;
+                break;
+            }
+            if (n == 0) {
+                if (!member_ended) status = -1; // truncated
+                break;
+            }
+            strm.next_in = in;
+            strm.avail_in = (uInt)n;
+        }
+
+        if (member_ended) {
+            // Concatenated members (e.g. `cat a.gz b.gz`) continue the stream;
+            // anything else after a member is trailing garbage, ignored like gzip does
+            if (strm.next_in[0] != 0x1f) break;
+            inflateReset(&strm);
+            member_ended = 0;
+        }
+
+        strm.next_out = (unsigned char*)*out + *out_len;
+        strm.avail_out = (uInt)(DECODER_BLOCK_SIZE - *out_len);
+        int rc = inflate(&strm, Z_NO_FLUSH);
+        *out_len = DECODER_BLOCK_SIZE - strm.avail_out;
+        if (rc == Z_STREAM_END) {
+            member_ended = 1;
+        } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            fprintf(stderr, "Error: gzip input is corrupt (%s).\n", strm.msg ? strm.msg : "inflate failed");
+            status = -1;
+            break;
+        }
+
+        *out = emit_if_full(decoder, *out, out_len);
+        if (*out == NULL) {
+            status = -1;
+            break;
+        }
+    }
+
+    inflateEnd(&strm);
+    return status;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int decode_zstd(decoder_t* decoder, unsigned char* in, char** out, size_t* out_len)
+{
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == NULL) {
+        return -1;
+    }
+    ZSTD_initDStream(stream);
+
+    int status = 0;
+    size_t pending = 0; // Non-zero while a frame is incomplete
+    while (status == 0) {
+        *out = emit_before_wait(decoder, *out, out_len);
+        if (*out == NULL) {
+            status = -1;
+            break;
+        }
+        ssize_t n = read_input(decoder, in, DECODER_INPUT_SIZE);
+        if (n <= 0) {
+            if (n < 0 || pending != 0) status = -1; // error or truncated frame
+            break;
+        }
+
+        ZSTD_inBuffer input = { in, (size_t)n, 0 };
+        int out_full;
+        do {
+            ZSTD_outBuffer output = { *out + *out_len, DECODER_BLOCK_SIZE - *out_len, 0 };
+            pending = ZSTD_decompressStream(stream, &output, &input);
+            if (ZSTD_isError(pending)) {
+                fprintf(stderr, "Error: zstd input is corrupt (%s).\n", ZSTD_getErrorName(pending));
+                status = -1;
+                break;
+            }
+            *out_len += output.pos;
+            out_full = (output.pos == output.size);
+
+            *out = emit_if_full(decoder, *out, out_len);
+            if (*out == NULL) {
+                status = -1;
+                break;
+            }
+        } while (input.pos < input.size || out_full);
+    }
+
+    ZSTD_freeDStream(stream);
+    return status;
+}
+#endif
+
+static void* decoder_thread(void* arg)
+{
+    decoder_t* decoder = arg;
+    unsigned char* in = malloc(DECODER_INPUT_SIZE);
+    char* out = malloc(DECODER_BLOCK_SIZE);
+    size_t out_len = 0;
+    int status = -1;
+
+    if (in != NULL && out != NULL) {
+#ifdef HAVE_ZLIB
+        if (decoder->kind == COMPRESSION_GZIP) {
+            status = decode_gzip(decoder, in, &out, &out_len);
+        }
+#endif
+#ifdef HAVE_ZSTD
+        if (decoder->kind == COMPRESSION_ZSTD) {
+            status = decode_zstd(decoder, in, &out, &out_len);
+        }
+#endif
+    }
+
+    // The last, partly filled block
+    if (out != NULL && out_len > 0 && push_block(decoder, out, out_len) == 0) {
+        out = NULL;
+    }
+    free(out);
+    free(in);
+    finish(decoder, status != 0);
+    return NULL;
+}
+
+int decoder_start(decoder_t* decoder, int fd, compression_t kind, const unsigned char* prefix, size_t prefix_len)
+{
+    if (decoder == NULL) {
+        fprintf(stderr, "Error: decoder_start received NULL.\n");
+        return -1;
+    }
+    if (kind == COMPRESSION_NONE || !compression_supported(kind)) {
+        fprintf(stderr, "Error: %s input is not supported by this build.\n", compression_name(kind));
+        return -1;
+    }
+
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->fd = fd;
+    decoder->kind = kind;
+    if (prefix_len > COMPRESSION_MAGIC_MAX) prefix_len = COMPRESSION_MAGIC_MAX;
+    memcpy(decoder->prefix, prefix, prefix_len);
+    decoder->prefix_len = prefix_len;
+
+    decoder->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (decoder->stop_fd < 0) {
+        return -1;
+    }
+    pthread_mutex_init(&decoder->mutex, NULL);
+    pthread_cond_init(&decoder->not_empty, NULL);
+    pthread_cond_init(&decoder->not_full, NULL);
+
+    if (pthread_create(&decoder->thread, NULL, decoder_thread, decoder) != 0) {
+        fprintf(stderr, "Error: Failed to start decoder thread.\n");
+        close(decoder->stop_fd);
+        pthread_mutex_destroy(&decoder->mutex);
+        pthread_cond_destroy(&decoder->not_empty);
+        pthread_cond_destroy(&decoder->not_full);
+        return -1;
+    }
+    decoder->started = 1;
+    return 0;
+}
+
+ssize_t decoder_read(void* ctx, char* dst, size_t len)
+{
+    decoder_t* decoder = ctx;
+
+    pthread_mutex_lock(&decoder->mutex);
+    while (decoder->count == 0 && !decoder->done) {
+        pthread_cond_wait(&decoder->not_empty, &decoder->mutex);
+    }
+    if (decoder->count == 0) {
+        int error = decoder->error;
+        pthread_mutex_unlock(&decoder->mutex);
+        return error ? -1 : 0;
+    }
+    decoder_block_t* block = &decoder->blocks[decoder->head];
+    pthread_mutex_unlock(&decoder->mutex);
+
+    // Only this thread touches the head block until it is released below
+    size_t n = block->len - decoder->consumed;
+    if (n > len) n = len;
+    memcpy(dst, block->data + decoder->consumed, n);
+    decoder->consumed += n;
+
+    if (decoder->consumed == block->len) {
+        free(block->data);
+        block->data = NULL;
+        decoder->consumed = 0;
+
+        pthread_mutex_lock(&decoder->mutex);
+        decoder->head = (decoder->head + 1) % DECODER_QUEUE_DEPTH;
+        decoder->count--;
+        pthread_cond_signal(&decoder->not_full);
+        pthread_mutex_unlock(&decoder->mutex);
+    }
+    return (ssize_t)n;
+}
+
+void decoder_stop(decoder_t* decoder)
+{
+    if (decoder == NULL) {
+        fprintf(stderr, "Error: decoder_stop received NULL.\n");
+        return;
+    }
+    if (!decoder->started) {
+        return;
+    }
+
+    pthread_mutex_lock(&decoder->mutex);
+    decoder->stop = 1;
+    pthread_cond_broadcast(&decoder->not_full);
+    pthread_mutex_unlock(&decoder->mutex);
+
+    uint64_t one = 1;
+    if (write(decoder->stop_fd, &one, sizeof(one)) < 0) {
+        // The flag alone still stops it at the next block
+    }
+    pthread_join(decoder->thread, NULL);
+
+    while (decoder->count > 0) {
+        free(decoder->blocks[decoder->head].data);
+        decoder->head = (decoder->head + 1) % DECODER_QUEUE_DEPTH;
+        decoder->count--;
+    }
+    close(decoder->stop_fd);
+    pthread_mutex_destroy(&decoder->mutex);
+    pthread_cond_destroy(&decoder->not_empty);
+    pthread_cond_destroy(&decoder->not_full);
+    decoder->started = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define DECODER_BLOCK_SIZE (256 * 1024) // Decoded bytes per block handed to the line splitter
+#define DECODER_QUEUE_DEPTH 4 // Decoded blocks the decoder may run ahead
+#define COMPRESSION_MAGIC_MAX 4 // Bytes needed to recognize every format
+
+// Compressed formats recognized by their leading magic bytes
+typedef enum
+{
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP, // 1f 8b (zlib)
+    COMPRESSION_ZSTD, // 28 b5 2f fd (libzstd)
+} compression_t;
+
+// One block of decoded output
+typedef struct
+{
+    char* data;
+    size_t len;
+} decoder_block_t;
+
+// Decompresses a descriptor on its own thread into a small queue of blocks
+// The consumer pulls decoded bytes with decoder_read, as if from read()
+typedef struct
+{
+    int fd; // Compressed input (not owned)
+    int stop_fd; // eventfd - wakes the decoder out of a blocking read when stopping
+    compression_t kind;
+    unsigned char prefix[COMPRESSION_MAGIC_MAX]; // Bytes consumed from fd while detecting the format
+    size_t prefix_len;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    decoder_block_t blocks[DECODER_QUEUE_DEPTH];
+    int head; // Oldest block
+    int count; // Blocks queued
+    size_t consumed; // Bytes of the head block already read
+    int done; // Decoder reached the end of input
+    int error; // Decoder failed (corrupt or truncated input)
+    int stop; // Consumer is going away
+    int started;
+} decoder_t;
+
+/**
+* Recognize a compressed format from the first bytes of the input
+* @param data First bytes of the input
+* @param len Number of bytes available (up to COMPRESSION_MAGIC_MAX)
+* @return The format, COMPRESSION_NONE for anything else
+*/
+compression_t compression_detect(const unsigned char* data, size_t len);
+
+/**
+* Check whether this build can decode a format
+* @param kind Format
+* @return 1 if supported, 0 if the library was not available at build time
+*/
+int compression_supported(compression_t kind);
+
+/**
+* Name of a format (for messages)
+* @param kind Format
+* @return "gzip", "zstd" or "none"
+*/
+const char* compression_name(compression_t kind);
+
+/**
+* Start decoding fd on a new thread
+* @param decoder Pointer to decoder structure
+* @param fd Compressed input
+* @param kind Format (must be supported)
+* @param prefix Bytes already read from fd, decoded before the rest
+* @param prefix_len Number of prefix bytes (up to COMPRESSION_MAGIC_MAX)
+* @return 0 on success, -1 on failure
+*/
+int decoder_start(decoder_t* decoder, int fd, compression_t kind, const unsigned char* prefix, size_t prefix_len);
+
+/**
+* read()-like: copy up to len decoded bytes into dst, waiting for the decoder
+* Matches line_reader_read_fn so it can feed a line_reader
+* @param ctx Pointer to decoder structure
+* @param dst Destination
+* @param len Space in dst
+* @return Bytes copied, 0 at end of input, -1 if the input could not be decoded
+*/
+ssize_t decoder_read(void* ctx, char* dst, size_t len);
+
+/**
+* Stop the decoder thread (even if it is blocked reading) and free its blocks
+* @param decoder Pointer to decoder structure
+*/
+void decoder_stop(decoder_t* decoder);
+
+#endif // DECOMPRESS_H
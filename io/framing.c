@@ -0,0 +1,53 @@
+#include "framing.h"
+#include <string.h>
+#include <stdint.h>
+
+
+int framing_from_name(const char* name, input_framing_t* framing)
+{
+    if (strcmp(name, "lines") == 0) {
+        *framing = INPUT_FRAMING_LINES;
+    } else if (strcmp(name, "u32") == 0) {
+        *framing = INPUT_FRAMING_U32;
+    } else if (strcmp(name, "varint") == 0) {
+        *framing = INPUT_FRAMING_VARINT;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int framing_decode_header(input_framing_t framing, const unsigned char* data, size_t available,
+                          size_t* header_len, size_t* payload_len)
+{
+    if (framing == INPUT_FRAMING_U32) {
+        if (available < 4) {
+            return 0;
+        }
+        *header_len = 4;
+        *payload_len = ((size_t)data[0] << 24) | ((size_t)data[1] << 16) |
+                       ((size_t)data[2] << 8) | (size_t)data[3];
+        return 1;
+    }
+
+    if (framing == INPUT_FRAMING_VARINT) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < FRAMING_VARINT_MAX_BYTES; ++i) {
+            if (i == available) {
+                return 0;
+            }
+            value |= (uint64_t)(data[i] & 0x7f) << (7 * i);
+            if ((data[i] & 0x80) == 0) {
+                if (value > UINT32_MAX) {
+                    return -1;
+                }
+                *header_len = i + 1;
+                *payload_len = (size_t)value;
+                return 1;
+            }
+        }
+        return -1; // continuation bit set on the last allowed byte
+    }
+
+    return -1;
+}
@@ -0,0 +1,36 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <stddef.h>
+
+// How records are delimited in the input stream
+typedef enum
+{
+    INPUT_FRAMING_LINES, // '\n' terminated text; a literal <END> line stops the pipeline
+    INPUT_FRAMING_U32, // 4 byte big-endian length, then that many payload bytes
+    INPUT_FRAMING_VARINT, // unsigned LEB128 length (as in protobuf), then the payload
+} input_framing_t;
+
+#define FRAMING_VARINT_MAX_BYTES 5 // Lengths are limited to 32 bits in both framed modes
+
+/**
+* Parse a --framing value
+* @param name "lines", "u32" or "varint"
+* @param framing Set to the matching mode
+* @return 0 on success, -1 for an unknown name
+*/
+int framing_from_name(const char* name, input_framing_t* framing);
+
+/**
+* Decode the length header at the start of data
+* @param framing INPUT_FRAMING_U32 or INPUT_FRAMING_VARINT
+* @param data Buffered input
+* @param available Number of bytes in data
+* @param header_len Set to the size of the header
+* @param payload_len Set to the payload length that follows it
+* @return 1 when the header is complete, 0 if more bytes are needed, -1 if it is malformed
+*/
+int framing_decode_header(input_framing_t framing, const unsigned char* data, size_t available,
+                          size_t* header_len, size_t* payload_len);
+
+#endif // FRAMING_H
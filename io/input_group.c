@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include "input_group.h"
+#include "input_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+// One copied line waiting in an ordered queue
+typedef struct
+{
+    char* data;
+    size_t len;
+} group_line_t;
+
+// Bounded per-input queue used in ordered mode - the reader fills it ahead of
+// the forwarder, which only drains it once every earlier input is done
+typedef struct
+{
+    group_line_t* lines;
+    int capacity;
+    int count;
+    int head;
+    int done; // The reader will not add more
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} group_queue_t;
+
+typedef struct
+{
+    const char* const* paths;
+    int count;
+    const input_group_options_t* options;
+    input_group_deliver_t deliver;
+    void* ctx;
+    group_queue_t* queues; // One per input, NULL when unordered
+    pthread_mutex_t mutex; // Guards next_input and failed
+    int next_input; // Next input to hand to a reader
+    int failed; // Some input could not be read completely
+    int aborted; // deliver asked to stop - readers bail out; only via group_aborted/group_abort
+} input_group_t;
+
+// aborted is set by whichever thread's delivery failed and polled by all the others
+static int group_aborted(input_group_t* group)
+{
+    return __atomic_load_n(&group->aborted, __ATOMIC_ACQUIRE);
+}
+
+static void group_abort(input_group_t* group)
+{
+    __atomic_store_n(&group->aborted, 1, __ATOMIC_RELEASE);
+}
+
+static int queue_push(input_group_t* group, group_queue_t* queue, const char* line, size_t len)
+{
+    char* copy = malloc(len + 1);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->capacity && !group_aborted(group)) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    if (group_aborted(group)) {
+        pthread_mutex_unlock(&queue->mutex);
+        free(copy);
+        return -1;
+    }
+
+    int tail = (queue->head + queue->count) % queue->capacity;
+    queue->lines[tail].data = copy;
+    queue->lines[tail].len = len;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+static void queue_finish(group_queue_t* queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->done = 1;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Take the next line, waiting for the reader; returns 0 once the input is exhausted
+static int queue_pop(group_queue_t* queue, group_line_t* line)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && !queue->done) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->mutex);
+        return 0;
+    }
+
+    *line = queue->lines[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+    return 1;
+}
+
+static void mark_failed(input_group_t* group)
+{
+    pthread_mutex_lock(&group->mutex);
+    group->failed = 1;
+    pthread_mutex_unlock(&group->mutex);
+}
+
+// Read one input to its end (or its <END> line)
+static void read_input(input_group_t* group, int index)
+{
+    const char* path = group->paths[index];
+    group_queue_t* queue = group->queues ? &group->queues[index] : NULL;
+
+    input_source_t source;
+    if (input_source_open(&source, path, group->options->framing) != 0) {
+        fprintf(stderr, "[ERROR] Cannot open input '%s'\n", path);
+        mark_failed(group);
+        return;
+    }
+
+    const char* line;
+    size_t len;
+    int rc = 0;
+    while (!group_aborted(group) && (rc = input_source_next(&source, &line, &len)) > 0) {
+        if (input_source_is_end(line, len)) {
+            break;
+        }
+
+        int delivered = queue ? queue_push(group, queue, line, len)
+                              : group->deliver(group->ctx, line, len);
+        if (delivered != 0) {
+            group_abort(group);
+            break;
+        }
+    }
+
+    if (rc < 0) {
+        fprintf(stderr, "[ERROR] Failed to read input from %s.\n", source.name);
+        mark_failed(group);
+    }
+    input_source_close(&source);
+}
+
+static void* reader_thread(void* arg)
+{
+    input_group_t* group = arg;
+
+    while (!group_aborted(group)) {
+        pthread_mutex_lock(&group->mutex);
+        int index = group->next_input++;
+        pthread_mutex_unlock(&group->mutex);
+        if (index >= group->count) {
+            break;
+        }
+
+        read_input(group, index);
+        if (group->queues) {
+            queue_finish(&group->queues[index]);
+        }
+    }
+    return NULL;
+}
+
+// Ordered mode: drain input 0 completely, then input 1, ...
+static void forward_in_order(input_group_t* group)
+{
+    for (int i = 0; i < group->count; ++i) {
+        group_line_t line;
+        while (queue_pop(&group->queues[i], &line)) {
+            if (!group_aborted(group) && group->deliver(group->ctx, line.data, line.len) != 0) {
+                group_abort(group);
+            }
+            free(line.data);
+        }
+
+        if (group_aborted(group)) {
+            // Unblock readers stuck on full queues
+            for (int j = i; j < group->count; ++j) {
+                pthread_mutex_lock(&group->queues[j].mutex);
+                pthread_cond_broadcast(&group->queues[j].not_full);
+                pthread_mutex_unlock(&group->queues[j].mutex);
+            }
+        }
+    }
+}
+
+static void destroy_queues(input_group_t* group)
+{
+    for (int i = 0; i < group->count; ++i) {
+        group_queue_t* queue = &group->queues[i];
+        while (queue->count > 0) {
+            free(queue->lines[queue->head].data);
+            queue->head = (queue->head + 1) % queue->capacity;
+            queue->count--;
+        }
+        free(queue->lines);
+        pthread_mutex_destroy(&queue->mutex);
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_cond_destroy(&queue->not_full);
+    }
+    free(group->queues);
+    group->queues = NULL;
+}
+
+static int create_queues(input_group_t* group)
+{
+    group->queues = calloc((size_t)group->count, sizeof(group_queue_t));
+    if (group->queues == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < group->count; ++i) {
+        group_queue_t* queue = &group->queues[i];
+        pthread_mutex_init(&queue->mutex, NULL);
+        pthread_cond_init(&queue->not_empty, NULL);
+        pthread_cond_init(&queue->not_full, NULL);
+        queue->capacity = INPUT_GROUP_QUEUE_LINES;
+        queue->lines = malloc(sizeof(group_line_t) * (size_t)queue->capacity);
+        if (queue->lines == NULL) {
+            group->count = i + 1;
+            destroy_queues(group);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int input_group_run(const char* const* paths, int count, const input_group_options_t* options,
+                    input_group_deliver_t deliver, void* ctx)
+{
+    if (paths == NULL || options == NULL || deliver == NULL) {
+        fprintf(stderr, "Error: input_group_run received NULL.\n");
+        return -1;
+    }
+
+    input_group_t group;
+    memset(&group, 0, sizeof(group));
+    group.paths = paths;
+    group.count = count;
+    group.options = options;
+    group.deliver = deliver;
+    group.ctx = ctx;
+    pthread_mutex_init(&group.mutex, NULL);
+
+    if (options->ordered && create_queues(&group) != 0) {
+        fprintf(stderr, "Error: Failed to allocate input queues.\n");
+        pthread_mutex_destroy(&group.mutex);
+        return -1;
+    }
+
+    int readers = options->readers > 0 ? options->readers : INPUT_GROUP_DEFAULT_READERS;
+    if (readers > count) readers = count;
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * (size_t)readers);
+    int started = 0;
+    if (threads != NULL) {
+        for (; started < readers; ++started) {
+            if (pthread_create(&threads[started], NULL, reader_thread, &group) != 0) {
+                break;
+            }
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Error: Failed to start input reader threads.\n");
+        group.failed = 1;
+        group_abort(&group);
+    }
+
+    if (group.queues && started > 0) {
+        forward_in_order(&group);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    if (group.queues) {
+        destroy_queues(&group);
+    }
+    pthread_mutex_destroy(&group.mutex);
+    return (group.failed || group_aborted(&group)) ? -1 : 0;
+}
@@ -0,0 +1,38 @@
+#ifndef INPUT_GROUP_H
+#define INPUT_GROUP_H
+
+#include <stddef.h>
+#include "framing.h"
+
+#define INPUT_GROUP_DEFAULT_READERS 4
+#define INPUT_GROUP_QUEUE_LINES 1024 // Lines buffered per file in ordered mode
+
+// Called for every line, from reader threads (unordered) or from the caller (ordered)
+// Must copy the line if it keeps it; returns 0 to go on, -1 to stop reading everything
+typedef int (*input_group_deliver_t)(void* ctx, const char* line, size_t len);
+
+// How a group of inputs is read
+typedef struct
+{
+    input_framing_t framing; // Same framing for every input
+    int readers; // Reader threads, each reads one input at a time
+    int ordered; // Deliver input 1 completely, then input 2, ... (reads still overlap)
+} input_group_options_t;
+
+/**
+* Read several inputs concurrently and deliver their lines
+* Inputs are paths, "-" for stdin or "fd:<n>"; each is handed to the next free
+* reader thread in command line order. Lines of one input always arrive in
+* order; without `ordered` lines of different inputs interleave. A "<END>" line
+* ends only the input it appears in
+* @param paths Inputs
+* @param count Number of inputs
+* @param options Framing, thread count and ordering
+* @param deliver Line callback
+* @param ctx Passed to deliver
+* @return 0 if every input was read completely, -1 otherwise (errors are printed)
+*/
+int input_group_run(const char* const* paths, int count, const input_group_options_t* options,
+                    input_group_deliver_t deliver, void* ctx);
+
+#endif // INPUT_GROUP_H
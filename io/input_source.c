@@ -0,0 +1,230 @@
+#include "input_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Read the magic bytes of a stream, stopping early when the first byte already
+// rules out every format (so an interactive line is never held back)
+// Returns the number of bytes read, -1 on error
+static ssize_t peek_magic(int fd, unsigned char* magic)
+{
+    size_t got = 0;
+    while (got < COMPRESSION_MAGIC_MAX) {
+        ssize_t n = read(fd, magic + got, got == 0 ? 1 : COMPRESSION_MAGIC_MAX - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        got += (size_t)n;
+        if (magic[0] != 0x1f && magic[0] != 0x28) break;
+        if (compression_detect(magic, got) != COMPRESSION_NONE) break;
+    }
+    return (ssize_t)got;
+}
+
+// Point the line reader at its real refill: the decoder for compressed input,
+// io_uring if it was asked for and works, plain read() otherwise
+static int start_refill(input_source_t* source, const unsigned char* magic, size_t magic_len)
+{
+    if (source->compression != COMPRESSION_NONE) {
+        if (decoder_start(&source->decoder, source->fd, source->compression, magic, magic_len) != 0) {
+            source->compression = COMPRESSION_NONE; // nothing to stop on close
+            return -1;
+        }
+        line_reader_set_source(&source->reader, decoder_read, &source->decoder);
+        return 0;
+    }
+
+    line_reader_set_source(&source->reader, NULL, NULL);
+    if (source->try_uring && uring_reader_init(&source->uring, source->fd) == 0) {
+        source->uring_active = 1;
+        line_reader_set_source(&source->reader, uring_reader_read, &source->uring);
+    }
+    return 0;
+}
+
+// First refill of a stream: detect the format from its leading bytes, then
+// switch to the real refill. Done lazily so opening stdin never blocks
+static ssize_t detect_and_read(void* ctx, char* dst, size_t len)
+{
+    input_source_t* source = ctx;
+    unsigned char magic[COMPRESSION_MAGIC_MAX];
+    ssize_t magic_len = peek_magic(source->fd, magic);
+    if (magic_len < 0) {
+        return -1;
+    }
+
+    source->compression = compression_detect(magic, (size_t)magic_len);
+    if (start_refill(source, magic, (size_t)magic_len) != 0) {
+        return -1;
+    }
+    if (source->compression != COMPRESSION_NONE) {
+        return decoder_read(&source->decoder, dst, len);
+    }
+
+    // Plain text - the magic bytes are the start of the first line
+    memcpy(dst, magic, (size_t)magic_len);
+    return magic_len;
+}
+
+// Open path (or use source->fd) for block reads
+// Streams have their format detected on the first read; regular files were
+// already checked with pread (source->compression)
+static int open_stream(input_source_t* source, const char* path, int try_uring, int detect)
+{
+    source->kind = INPUT_SOURCE_STREAM;
+    source->try_uring = try_uring;
+    if (path != NULL) {
+        source->fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (source->fd < 0) {
+            return -1;
+        }
+        source->owns_fd = 1;
+    }
+
+    if (line_reader_init(&source->reader, source->fd, 0) != 0) {
+        goto fail;
+    }
+
+    if (detect) {
+        line_reader_set_source(&source->reader, detect_and_read, source);
+        return 0;
+    }
+    if (start_refill(source, NULL, 0) != 0) {
+        line_reader_destroy(&source->reader);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    if (source->owns_fd) {
+        close(source->fd);
+        source->fd = -1;
+        source->owns_fd = 0;
+    }
+    return -1;
+}
+
+// Check a regular file's magic bytes without consuming anything
+static compression_t detect_file(input_source_t* source, const char* path)
+{
+    unsigned char magic[COMPRESSION_MAGIC_MAX];
+    ssize_t n = -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        n = pread(fd, magic, sizeof(magic), 0);
+        close(fd);
+    }
+    source->compression = compression_detect(magic, n > 0 ? (size_t)n : 0);
+    return source->compression;
+}
+
+int input_source_open(input_source_t* source, const char* path, input_framing_t framing)
+{
+    if (source == NULL) {
+        fprintf(stderr, "Error: input_source_open received NULL.\n");
+        return -1;
+    }
+
+    memset(source, 0, sizeof(*source));
+    source->fd = -1;
+    source->mapped.fd = -1;
+    source->framing = framing;
+
+    int try_uring = (uring_engine_requested() == 1);
+
+    if (path == NULL || strcmp(path, "-") == 0) {
+        source->name = "stdin";
+        source->fd = STDIN_FILENO;
+        return open_stream(source, NULL, try_uring, 1);
+    }
+
+    // "fd:<n>" - an already open descriptor (e.g. a pipe set up by the caller)
+    if (strncmp(path, "fd:", 3) == 0 && path[3] != '\0' && strspn(path + 3, "0123456789") == strlen(path + 3)) {
+        source->name = path;
+        source->fd = atoi(path + 3);
+        if (fcntl(source->fd, F_GETFD) < 0) {
+            return -1;
+        }
+        return open_stream(source, NULL, try_uring, 1);
+    }
+
+    source->name = path;
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+        // A compressed file cannot be mapped as lines - decode it as a stream
+        if (detect_file(source, path) != COMPRESSION_NONE) {
+            return open_stream(source, path, 0, 0);
+        }
+        if (try_uring) {
+            if (open_stream(source, path, 1, 0) != 0) {
+                return -1;
+            }
+            if (source->uring_active) {
+                return 0;
+            }
+            // No io_uring here - a mapping beats plain read() for regular files
+            input_source_close(source);
+            source->owns_fd = 0;
+        }
+        source->kind = INPUT_SOURCE_MMAP;
+        return mmap_input_open(&source->mapped, path);
+    }
+
+    // FIFOs, character devices, /dev/stdin and the like cannot be mapped
+    return open_stream(source, path, try_uring, 1);
+}
+
+void input_source_close(input_source_t* source)
+{
+    if (source == NULL) {
+        fprintf(stderr, "Error: input_source_close received NULL.\n");
+        return;
+    }
+
+    if (source->kind == INPUT_SOURCE_MMAP) {
+        mmap_input_close(&source->mapped);
+        return;
+    }
+
+    // The decoder may still be filling blocks - stop it before the reader goes
+    if (source->compression != COMPRESSION_NONE) {
+        decoder_stop(&source->decoder);
+    }
+    line_reader_destroy(&source->reader);
+    if (source->uring_active) {
+        uring_reader_destroy(&source->uring);
+        source->uring_active = 0;
+    }
+    if (source->owns_fd && source->fd >= 0) {
+        close(source->fd);
+    }
+    source->fd = -1;
+}
+
+int input_source_next(input_source_t* source, const char** line, size_t* len)
+{
+    if (source->kind == INPUT_SOURCE_MMAP) {
+        if (source->framing != INPUT_FRAMING_LINES) {
+            return mmap_input_next_frame(&source->mapped, source->framing, line, len);
+        }
+        return mmap_input_next(&source->mapped, line, len);
+    }
+
+    char* text = NULL;
+    int rc = (source->framing != INPUT_FRAMING_LINES)
+        ? line_reader_next_frame(&source->reader, source->framing, &text, len)
+        : line_reader_next(&source->reader, &text, len);
+    *line = text;
+    return rc;
+}
+
+int input_source_is_end(const char* line, size_t len)
+{
+    // Stages compare C strings, so anything up to a '\0' that reads "<END>" counts
+    return len >= 5 && memcmp(line, "<END>", 5) == 0 && (len == 5 || line[5] == '\0');
+}
@@ -0,0 +1,73 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <stddef.h>
+#include "line_reader.h"
+#include "mmap_input.h"
+#include "uring_reader.h"
+#include "decompress.h"
+
+typedef enum
+{
+    INPUT_SOURCE_STREAM, // read() (or io_uring) into a block buffer (stdin, pipes, devices)
+    INPUT_SOURCE_MMAP, // regular file, lines are slices of the mapping
+} input_source_kind_t;
+
+// Where the pipeline's lines come from
+// Must stay at the same address between open and close (the reader points back at it)
+typedef struct
+{
+    input_source_kind_t kind; // Which of the readers below is in use
+    const char* name; // Path, or "stdin" (for messages)
+    int fd; // Descriptor for STREAM sources
+    int owns_fd; // fd was opened here and must be closed
+    line_reader_t reader; // STREAM state
+    uring_reader_t uring; // STREAM refill when the io_uring engine is selected
+    int try_uring; // The io_uring engine was selected
+    int uring_active; // uring is set up and feeding reader
+    decoder_t decoder; // STREAM refill for compressed input
+    compression_t compression; // Detected format, COMPRESSION_NONE for plain text
+    input_framing_t framing; // Lines or length-prefixed frames
+    mmap_input_t mapped; // MMAP state
+} input_source_t;
+
+/**
+* Open an input: regular files are memory mapped, anything else is read in blocks
+* With ANALYZER_IO_ENGINE=uring everything is read in blocks through io_uring
+* (regular files with several reads in flight); if the kernel refuses io_uring
+* the default behavior is used
+* gzip and zstd input is recognized by its magic bytes and decompressed on a
+* decoder thread in front of the line splitter
+* @param source Pointer to source structure
+* @param path File to read, NULL or "-" for stdin, "fd:<n>" for an open descriptor
+* @param framing How records are delimited (INPUT_FRAMING_LINES for text)
+* @return 0 on success, -1 on failure
+*/
+int input_source_open(input_source_t* source, const char* path, input_framing_t framing);
+
+/**
+* Release the source (closes fds it opened)
+* @param source Pointer to source structure
+*/
+void input_source_close(input_source_t* source);
+
+/**
+* Return the next line without its '\n' (or the next frame's payload)
+* The line is NOT guaranteed to be '\0' terminated - always use len
+* It stays valid until the next call
+* @param source Pointer to source structure
+* @param line Set to the start of the line
+* @param len Set to the length of the line
+* @return 1 if a line was returned, 0 at end of input, -1 on read error or a bad frame
+*/
+int input_source_next(input_source_t* source, const char** line, size_t* len);
+
+/**
+* Check whether a line is the "<END>" marker as the stages will see it
+* @param line Line bytes
+* @param len Length of the line
+* @return 1 if it ends the stream, 0 otherwise
+*/
+int input_source_is_end(const char* line, size_t len);
+
+#endif // INPUT_SOURCE_H
@@ -0,0 +1,158 @@
+#include "line_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+int line_reader_init(line_reader_t* reader, int fd, size_t block_size)
+{
+    if (reader == NULL) {
+        fprintf(stderr, "Error: line_reader_init received NULL.\n");
+        return -1;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->block_size = block_size ? block_size : LINE_READER_BLOCK_SIZE;
+    reader->capacity = reader->block_size * 2;
+    reader->buffer = malloc(reader->capacity);
+    if (reader->buffer == NULL) {
+        fprintf(stderr, "Error: Failed to allocate line reader buffer.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void line_reader_set_source(line_reader_t* reader, line_reader_read_fn read_fn, void* ctx)
+{
+    reader->read_fn = read_fn;
+    reader->read_ctx = ctx;
+}
+
+void line_reader_destroy(line_reader_t* reader)
+{
+    if (reader == NULL) {
+        fprintf(stderr, "Error: line_reader_destroy received NULL.\n");
+        return;
+    }
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = reader->start = reader->scanned = reader->end = 0;
+}
+
+// Make room for at least one more block after end (one byte is always kept free
+// so a final unterminated line can be '\0' terminated)
+static int make_room(line_reader_t* reader)
+{
+    if (reader->start > 0) {
+        size_t pending = reader->end - reader->start;
+        memmove(reader->buffer, reader->buffer + reader->start, pending);
+        reader->end = pending;
+        reader->start = 0;
+    }
+
+    if (reader->capacity - reader->end - 1 < reader->block_size) {
+        size_t new_capacity = reader->capacity * 2;
+        while (new_capacity - reader->end - 1 < reader->block_size) new_capacity *= 2;
+        char* grown = realloc(reader->buffer, new_capacity);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Failed to grow line reader buffer.\n");
+            return -1;
+        }
+        reader->buffer = grown;
+        reader->capacity = new_capacity;
+    }
+    return 0;
+}
+
+// Read the next block after end
+// Returns bytes read, 0 at end of input, -1 on error
+static ssize_t refill(line_reader_t* reader)
+{
+    if (make_room(reader) != 0) {
+        return -1;
+    }
+
+    while (1) {
+        char* dst = reader->buffer + reader->end;
+        size_t space = reader->capacity - reader->end - 1;
+        ssize_t n = reader->read_fn ? reader->read_fn(reader->read_ctx, dst, space)
+                                    : read(reader->fd, dst, space);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) {
+            reader->eof = 1;
+        }
+        reader->end += (size_t)n;
+        return n;
+    }
+}
+
+int line_reader_next(line_reader_t* reader, char** line, size_t* len)
+{
+    while (1) {
+        // glibc memchr compares a whole vector register of bytes per step
+        char* from = reader->buffer + reader->start + reader->scanned;
+        char* newline = memchr(from, '\n', reader->end - reader->start - reader->scanned);
+        if (newline != NULL) {
+            *newline = '\0';
+            *line = reader->buffer + reader->start;
+            *len = (size_t)(newline - *line);
+            reader->start += *len + 1;
+            reader->scanned = 0;
+            return 1;
+        }
+        reader->scanned = reader->end - reader->start;
+
+        if (reader->eof) {
+            if (reader->start == reader->end) {
+                return 0;
+            }
+            // Last line had no '\n'
+            reader->buffer[reader->end] = '\0';
+            *line = reader->buffer + reader->start;
+            *len = reader->end - reader->start;
+            reader->start = reader->end;
+            reader->scanned = 0;
+            return 1;
+        }
+
+        if (refill(reader) < 0) {
+            return -1;
+        }
+    }
+}
+
+int line_reader_next_frame(line_reader_t* reader, input_framing_t framing, char** payload, size_t* len)
+{
+    while (1) {
+        size_t available = reader->end - reader->start;
+        size_t header_len = 0;
+        size_t payload_len = 0;
+        int rc = framing_decode_header(framing, (const unsigned char*)reader->buffer + reader->start,
+                                       available, &header_len, &payload_len);
+        if (rc < 0) {
+            return -1;
+        }
+
+        // No delimiter scan - the header says exactly how much to wait for
+        if (rc == 1 && available - header_len >= payload_len) {
+            *payload = reader->buffer + reader->start + header_len;
+            *len = payload_len;
+            reader->start += header_len + payload_len;
+            return 1;
+        }
+
+        if (reader->eof) {
+            return available == 0 ? 0 : -1; // a frame was cut off
+        }
+
+        if (refill(reader) < 0) {
+            return -1;
+        }
+    }
+}
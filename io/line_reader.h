@@ -0,0 +1,78 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "framing.h"
+
+#define LINE_READER_BLOCK_SIZE (256 * 1024) // Default read() size
+
+// Alternative to read() for refilling the buffer (io_uring, a decoder thread, ...)
+// Same contract as read(): bytes copied, 0 at end of input, -1 on error
+typedef ssize_t (*line_reader_read_fn)(void* ctx, char* dst, size_t len);
+
+// Splits a file descriptor into newline terminated lines
+// Reads large blocks into one buffer; consumed lines are dropped by sliding the
+// unread tail to the front, and the buffer grows when a single line does not fit,
+// so lines have no length limit
+typedef struct
+{
+    int fd; // Input file descriptor (not owned)
+    char* buffer; // Block buffer
+    size_t capacity; // Allocated size of buffer
+    size_t start; // First byte of the next line
+    size_t scanned; // Bytes from start already known to hold no '\n'
+    size_t end; // End of the bytes read so far
+    size_t block_size; // Preferred read() size
+    int eof; // read() returned 0
+    line_reader_read_fn read_fn; // Refill through this instead of read() (optional)
+    void* read_ctx; // Passed to read_fn (not owned)
+} line_reader_t;
+
+/**
+* Initialize a line reader
+* @param reader Pointer to reader structure
+* @param fd File descriptor to read from
+* @param block_size Bytes to request per read(), 0 for LINE_READER_BLOCK_SIZE
+* @return 0 on success, -1 on failure
+*/
+int line_reader_init(line_reader_t* reader, int fd, size_t block_size);
+
+/**
+* Refill through read_fn instead of read() on fd
+* @param reader Pointer to reader structure
+* @param read_fn Refill function, NULL to go back to read()
+* @param ctx Passed to read_fn
+*/
+void line_reader_set_source(line_reader_t* reader, line_reader_read_fn read_fn, void* ctx);
+
+/**
+* Free the reader's buffer (does not close fd)
+* @param reader Pointer to reader structure
+*/
+void line_reader_destroy(line_reader_t* reader);
+
+/**
+* Return the next line without its '\n'
+* The line is '\0' terminated in place and stays valid until the next call
+* A last line without a trailing newline is still returned
+* @param reader Pointer to reader structure
+* @param line Set to the start of the line
+* @param len Set to the length of the line
+* @return 1 if a line was returned, 0 at end of input, -1 on read error
+*/
+int line_reader_next(line_reader_t* reader, char** line, size_t* len);
+
+/**
+* Return the payload of the next length-prefixed frame
+* The payload may contain '\n' and '\0' and is NOT '\0' terminated
+* It stays valid until the next call
+* @param reader Pointer to reader structure
+* @param framing INPUT_FRAMING_U32 or INPUT_FRAMING_VARINT
+* @param payload Set to the start of the payload
+* @param len Set to the payload length
+* @return 1 if a frame was returned, 0 at end of input, -1 on read error or a malformed/truncated frame
+*/
+int line_reader_next_frame(line_reader_t* reader, input_framing_t framing, char** payload, size_t* len);
+
+#endif // LINE_READER_H
@@ -0,0 +1,273 @@
+#define _GNU_SOURCE
+#include "metrics_exporter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+
+// Render into memory, so a slow reader never holds the render up and the
+// HTTP response knows its length
+static char* render_to_memory(metrics_exporter_t* exporter, size_t* len)
+{
+    char* text = NULL;
+    FILE* out = open_memstream(&text, len);
+    if (out == NULL) {
+        return NULL;
+    }
+    exporter->render(out, exporter->ctx);
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+static int write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Scrapers may hang up before reading the reply - that must only drop them,
+// never raise SIGPIPE in the analyzer
+static int send_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1; // EPIPE, ECONNRESET, ... - the caller closes the connection
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int write_metrics_file(metrics_exporter_t* exporter)
+{
+    FILE* out = fopen(exporter->temp_path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Error: Cannot write metrics '%s': %s\n", exporter->temp_path, strerror(errno));
+        return -1;
+    }
+    exporter->render(out, exporter->ctx);
+    if (fclose(out) != 0 || rename(exporter->temp_path, exporter->path) != 0) {
+        fprintf(stderr, "Error: Cannot write metrics '%s': %s\n", exporter->path, strerror(errno));
+        unlink(exporter->temp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// Read the request head (whatever it asks for, the answer is the metrics)
+// Gives up on scrapers that stay silent, so one cannot stall the others
+static int read_request(int fd)
+{
+    char request[METRICS_EXPORTER_REQUEST_MAX];
+    size_t used = 0;
+    while (used < sizeof(request) - 1) {
+        struct pollfd ready = { fd, POLLIN, 0 };
+        if (poll(&ready, 1, METRICS_EXPORTER_REQUEST_MS) <= 0) {
+            return -1;
+        }
+        ssize_t n = read(fd, request + used, sizeof(request) - 1 - used);
+        if (n <= 0) {
+            return -1;
+        }
+        used += (size_t)n;
+        request[used] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+            return 0;
+        }
+    }
+    return 0; // Oversized head - answer anyway
+}
+
+static void answer_scrape(metrics_exporter_t* exporter, int fd)
+{
+    if (read_request(fd) != 0) {
+        return;
+    }
+
+    size_t len = 0;
+    char* text = render_to_memory(exporter, &len);
+    if (text == NULL) {
+        static const char failed[] = "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        send_all(fd, failed, sizeof(failed) - 1);
+        return;
+    }
+    char head[160];
+    int head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.0 200 OK\r\n"
+                            "Content-Type: text/plain; version=0.0.4\r\n"
+                            "Content-Length: %zu\r\n"
+                            "Connection: close\r\n\r\n", len);
+    if (send_all(fd, head, (size_t)head_len) == 0) {
+        send_all(fd, text, len);
+    }
+    free(text);
+}
+
+static void* exporter_thread(void* arg)
+{
+    metrics_exporter_t* exporter = arg;
+    struct pollfd fds[2] = {
+        { exporter->stop_fd, POLLIN, 0 },
+        { exporter->listen_fd, POLLIN, 0 },
+    };
+    int nfds = exporter->listen_fd >= 0 ? 2 : 1;
+    int timeout = exporter->listen_fd >= 0 ? -1 : (int)exporter->interval_ms;
+
+    while (1) {
+        int n = poll(fds, (nfds_t)nfds, timeout);
+        if (n < 0 && errno != EINTR) {
+            fprintf(stderr, "Error: metrics exporter poll failed: %s\n", strerror(errno));
+            break;
+        }
+        if (n > 0 && (fds[0].revents & POLLIN)) {
+            break;
+        }
+        if (exporter->listen_fd < 0) {
+            if (n == 0) {
+                write_metrics_file(exporter);
+            }
+            continue;
+        }
+        if (n > 0 && (fds[1].revents & POLLIN)) {
+            int client = accept4(exporter->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client >= 0) {
+                answer_scrape(exporter, client);
+                close(client);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Listen on 127.0.0.1 only - the metrics are for local scrapers
+static int open_http(metrics_exporter_t* exporter, const char* port_text)
+{
+    char* end = NULL;
+    long port = strtol(port_text, &end, 10);
+    if (*port_text == '\0' || *end != '\0' || port < 1 || port > 65535) {
+        fprintf(stderr, "Error: Bad metrics port '%s'.\n", port_text);
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    exporter->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (exporter->listen_fd < 0 ||
+        setsockopt(exporter->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(exporter->listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(exporter->listen_fd, METRICS_EXPORTER_BACKLOG) != 0) {
+        fprintf(stderr, "Error: Cannot serve metrics on 127.0.0.1:%ld: %s\n", port, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int open_file(metrics_exporter_t* exporter, const char* path)
+{
+    size_t len = strlen(path);
+    exporter->path = strdup(path);
+    exporter->temp_path = malloc(len + sizeof(".tmp"));
+    if (exporter->path == NULL || exporter->temp_path == NULL) {
+        return -1;
+    }
+    memcpy(exporter->temp_path, path, len);
+    memcpy(exporter->temp_path + len, ".tmp", sizeof(".tmp"));
+    // First write right away: a bad path fails at startup, not a second later
+    return write_metrics_file(exporter);
+}
+
+int metrics_exporter_open(metrics_exporter_t* exporter, const char* target, long interval_ms,
+                          metrics_render_t render, void* ctx)
+{
+    if (exporter == NULL || target == NULL || render == NULL) {
+        fprintf(stderr, "Error: metrics_exporter_open received NULL.\n");
+        return -1;
+    }
+
+    memset(exporter, 0, sizeof(*exporter));
+    exporter->listen_fd = -1;
+    exporter->interval_ms = interval_ms > 0 ? interval_ms : METRICS_EXPORTER_DEFAULT_INTERVAL_MS;
+    exporter->render = render;
+    exporter->ctx = ctx;
+    exporter->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (exporter->stop_fd < 0) {
+        fprintf(stderr, "Error: eventfd failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int rc;
+    if (strncmp(target, "http:", 5) == 0) {
+        rc = open_http(exporter, target + 5);
+    } else if (strncmp(target, "file:", 5) == 0 && target[5] != '\0') {
+        rc = open_file(exporter, target + 5);
+    } else {
+        rc = -1;
+    }
+    if (rc == 0 && pthread_create(&exporter->thread, NULL, exporter_thread, exporter) != 0) {
+        fprintf(stderr, "Error: Failed to start metrics exporter.\n");
+        rc = -1;
+    }
+    if (rc != 0) {
+        metrics_exporter_close(exporter);
+        return -1;
+    }
+    exporter->running = 1;
+    return 0;
+}
+
+int metrics_exporter_close(metrics_exporter_t* exporter)
+{
+    if (exporter == NULL) {
+        fprintf(stderr, "Error: metrics_exporter_close received NULL.\n");
+        return -1;
+    }
+
+    int rc = 0;
+    if (exporter->running) {
+        uint64_t stop = 1;
+        write_all(exporter->stop_fd, (const char*)&stop, sizeof(stop));
+        pthread_join(exporter->thread, NULL);
+        exporter->running = 0;
+        if (exporter->path != NULL) {
+            rc = write_metrics_file(exporter); // Final counters, after the last line
+        }
+    }
+    if (exporter->listen_fd >= 0) {
+        close(exporter->listen_fd);
+    }
+    if (exporter->stop_fd >= 0) {
+        close(exporter->stop_fd);
+    }
+    free(exporter->path);
+    free(exporter->temp_path);
+    exporter->listen_fd = -1;
+    exporter->stop_fd = -1;
+    exporter->path = NULL;
+    exporter->temp_path = NULL;
+    return rc;
+}
@@ -0,0 +1,57 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define METRICS_EXPORTER_DEFAULT_INTERVAL_MS 1000 // file: rewrite period
+#define METRICS_EXPORTER_BACKLOG 16 // Pending scrapes the kernel queues
+#define METRICS_EXPORTER_REQUEST_MAX 4096 // Request bytes read before answering
+#define METRICS_EXPORTER_REQUEST_MS 1000 // A scraper gets this long to send its request
+
+/**
+* Write the current metrics as Prometheus exposition text
+* Called from the exporter's thread while the pipeline runs
+* @param out Where the text goes
+* @param ctx The ctx given to metrics_exporter_open
+*/
+typedef void (*metrics_render_t)(FILE* out, void* ctx);
+
+// Publishes metrics in Prometheus text format, on a thread of its own, to
+// "http:<port>" (answers every HTTP request on 127.0.0.1:<port> with the
+// current metrics - point a scrape job at it) or "file:<path>" (rewritten
+// every interval through a temporary file and rename, so readers never see
+// half a file - e.g. for node_exporter's textfile collector)
+typedef struct
+{
+    int listen_fd; // http: only, -1 otherwise
+    int stop_fd; // eventfd that wakes the thread to stop
+    char* path; // file: only, NULL otherwise
+    char* temp_path; // path + ".tmp", renamed over path
+    long interval_ms;
+    metrics_render_t render;
+    void* ctx;
+    pthread_t thread;
+    int running;
+} metrics_exporter_t;
+
+/**
+* Start exporting to "http:<port>" or "file:<path>"
+* @param exporter Pointer to exporter structure
+* @param target Where metrics go
+* @param interval_ms file: rewrite period (ignored for http:)
+* @param render Writes the metrics
+* @param ctx Passed to render
+* @return 0 on success, -1 on failure (bad target, port in use, ...)
+*/
+int metrics_exporter_open(metrics_exporter_t* exporter, const char* target, long interval_ms,
+                          metrics_render_t render, void* ctx);
+
+/**
+* Stop the thread; a file: target is rewritten one last time first
+* @param exporter Pointer to an opened exporter
+* @return 0 on success, -1 if the last write failed
+*/
+int metrics_exporter_close(metrics_exporter_t* exporter);
+
+#endif // METRICS_EXPORTER_H
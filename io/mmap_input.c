@@ -0,0 +1,125 @@
+#include "mmap_input.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+int mmap_input_open(mmap_input_t* input, const char* path)
+{
+    if (input == NULL || path == NULL) {
+        fprintf(stderr, "Error: mmap_input_open received NULL.\n");
+        return -1;
+    }
+
+    memset(input, 0, sizeof(*input));
+    input->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (input->fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(input->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(input->fd);
+        input->fd = -1;
+        return -1;
+    }
+
+    input->size = (size_t)st.st_size;
+    if (input->size == 0) {
+        return 0; // nothing to map, next() reports end of file right away
+    }
+
+    void* data = mmap(NULL, input->size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+    if (data == MAP_FAILED) {
+        close(input->fd);
+        input->fd = -1;
+        return -1;
+    }
+
+    // We read front to back exactly once: aggressive read-ahead, early reclaim
+    madvise(data, input->size, MADV_SEQUENTIAL);
+    input->data = data;
+    return 0;
+}
+
+void mmap_input_close(mmap_input_t* input)
+{
+    if (input == NULL) {
+        fprintf(stderr, "Error: mmap_input_close received NULL.\n");
+        return;
+    }
+
+    if (input->data != NULL) {
+        munmap((void*)input->data, input->size);
+        input->data = NULL;
+    }
+    if (input->fd >= 0) {
+        close(input->fd);
+        input->fd = -1;
+    }
+}
+
+// Give already consumed pages back so a multi-GB replay does not keep them resident
+static void release_consumed(mmap_input_t* input)
+{
+    if (input->pos - input->released < MMAP_INPUT_RELEASE_BYTES) {
+        return;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t upto = input->pos & ~(page - 1);
+    if (upto > input->released) {
+        madvise((void*)(input->data + input->released), upto - input->released, MADV_DONTNEED);
+        input->released = upto;
+    }
+}
+
+int mmap_input_next(mmap_input_t* input, const char** line, size_t* len)
+{
+    if (input->pos >= input->size) {
+        return 0;
+    }
+
+    // The previous line has been handed off by now
+    release_consumed(input);
+
+    const char* start = input->data + input->pos;
+    size_t remaining = input->size - input->pos;
+    const char* newline = memchr(start, '\n', remaining);
+
+    *line = start;
+    if (newline != NULL) {
+        *len = (size_t)(newline - start);
+        input->pos += *len + 1;
+    } else {
+        *len = remaining; // last line without '\n'
+        input->pos = input->size;
+    }
+    return 1;
+}
+
+int mmap_input_next_frame(mmap_input_t* input, input_framing_t framing, const char** payload, size_t* len)
+{
+    if (input->pos >= input->size) {
+        return 0;
+    }
+
+    release_consumed(input);
+
+    size_t remaining = input->size - input->pos;
+    size_t header_len = 0;
+    size_t payload_len = 0;
+    int rc = framing_decode_header(framing, (const unsigned char*)input->data + input->pos,
+                                   remaining, &header_len, &payload_len);
+    if (rc != 1 || remaining - header_len < payload_len) {
+        return -1; // the file ends inside this frame
+    }
+
+    *payload = input->data + input->pos + header_len;
+    *len = payload_len;
+    input->pos += header_len + payload_len;
+    return 1;
+}
@@ -0,0 +1,56 @@
+#ifndef MMAP_INPUT_H
+#define MMAP_INPUT_H
+
+#include <stddef.h>
+#include "framing.h"
+
+#define MMAP_INPUT_RELEASE_BYTES (64u << 20) // Drop consumed pages from the mapping every 64MB
+
+// A regular file mapped read-only and walked line by line
+// Lines are returned as slices of the mapping - nothing is copied here
+typedef struct
+{
+    int fd; // File descriptor of the mapped file
+    const char* data; // Start of the mapping, NULL for an empty file
+    size_t size; // File size
+    size_t pos; // Start of the next line
+    size_t released; // Bytes before this offset were already given back with MADV_DONTNEED
+} mmap_input_t;
+
+/**
+* Open and map a file, with sequential read-ahead advice
+* @param input Pointer to input structure
+* @param path File to map (must be a regular file)
+* @return 0 on success, -1 on failure
+*/
+int mmap_input_open(mmap_input_t* input, const char* path);
+
+/**
+* Unmap and close the file
+* Lines returned earlier become invalid
+* @param input Pointer to input structure
+*/
+void mmap_input_close(mmap_input_t* input);
+
+/**
+* Return the next line as a slice of the mapping
+* The slice is NOT '\0' terminated and excludes the '\n'
+* It stays valid until the next call (consumed pages may be dropped then)
+* @param input Pointer to input structure
+* @param line Set to the start of the line
+* @param len Set to the length of the line
+* @return 1 if a line was returned, 0 at end of file
+*/
+int mmap_input_next(mmap_input_t* input, const char** line, size_t* len);
+
+/**
+* Return the payload of the next length-prefixed frame as a slice of the mapping
+* @param input Pointer to input structure
+* @param framing INPUT_FRAMING_U32 or INPUT_FRAMING_VARINT
+* @param payload Set to the start of the payload (not '\0' terminated)
+* @param len Set to the payload length
+* @return 1 if a frame was returned, 0 at end of file, -1 on a malformed/truncated frame
+*/
+int mmap_input_next_frame(mmap_input_t* input, input_framing_t framing, const char** payload, size_t* len);
+
+#endif // MMAP_INPUT_H
@@ -0,0 +1,281 @@
+#define _GNU_SOURCE
+#include "output_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+int output_sink_parse_flush(const char* spec, output_sink_flush_t* flush)
+{
+    memset(flush, 0, sizeof(*flush));
+    if (strcmp(spec, "every") == 0) {
+        flush->every_line = 1;
+        return 0;
+    }
+    if (strcmp(spec, "end") == 0) {
+        return 0;
+    }
+
+    char* copy = strdup(spec);
+    if (copy == NULL) {
+        return -1;
+    }
+
+    int rc = 0;
+    char* save = NULL;
+    for (char* part = strtok_r(copy, ",", &save); part != NULL; part = strtok_r(NULL, ",", &save)) {
+        char* value = strchr(part, ':');
+        if (value == NULL || value[1] == '\0') {
+            rc = -1;
+            break;
+        }
+        *value++ = '\0';
+
+        char* end = NULL;
+        errno = 0;
+        unsigned long long number = strtoull(value, &end, 10);
+        if (errno != 0 || *end != '\0' || value[0] == '-') {
+            rc = -1;
+            break;
+        }
+
+        if (strcmp(part, "bytes") == 0) {
+            flush->bytes = (size_t)number;
+        } else if (strcmp(part, "ms") == 0) {
+            flush->interval_ms = (long)number;
+        } else {
+            rc = -1;
+            break;
+        }
+    }
+
+    free(copy);
+    return rc;
+}
+
+// Write every filled block with as few writev calls as the kernel allows
+static int flush_locked(output_sink_t* sink)
+{
+    if (sink->buffered == 0) {
+        return sink->error ? -1 : 0;
+    }
+
+    struct iovec iov[OUTPUT_SINK_MAX_BLOCKS];
+    int count = 0;
+    for (int i = 0; i < sink->block_count; ++i) {
+        if (sink->blocks[i].used == 0) continue;
+        iov[count].iov_base = sink->blocks[i].data;
+        iov[count].iov_len = sink->blocks[i].used;
+        count++;
+    }
+
+    struct iovec* next = iov;
+    while (count > 0 && !sink->error) {
+        ssize_t n = writev(sink->fd, next, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Output sink write failed: %s\n", strerror(errno));
+            sink->error = 1;
+            break;
+        }
+
+        // Skip what was written, resuming mid-block after a short write
+        while (count > 0 && (size_t)n >= next->iov_len) {
+            n -= (ssize_t)next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (char*)next->iov_base + n;
+            next->iov_len -= (size_t)n;
+        }
+    }
+
+    // Keep standard blocks for reuse, give back the oversized ones
+    for (int i = 0; i < sink->block_count; ++i) {
+        sink->blocks[i].used = 0;
+        if (sink->blocks[i].size > OUTPUT_SINK_BLOCK_SIZE) {
+            free(sink->blocks[i].data);
+            sink->blocks[i].data = NULL;
+            sink->blocks[i].size = 0;
+        }
+    }
+    sink->block_count = 0;
+    sink->buffered = 0;
+    return sink->error ? -1 : 0;
+}
+
+// Get a block with room for needed bytes, starting a new one (or flushing) if the current one is full
+static output_sink_block_t* block_for(output_sink_t* sink, size_t needed)
+{
+    if (sink->block_count > 0) {
+        output_sink_block_t* current = &sink->blocks[sink->block_count - 1];
+        if (current->size - current->used >= needed) {
+            return current;
+        }
+    }
+
+    if (sink->block_count == OUTPUT_SINK_MAX_BLOCKS && flush_locked(sink) != 0) {
+        return NULL;
+    }
+
+    output_sink_block_t* block = &sink->blocks[sink->block_count];
+    size_t size = needed > OUTPUT_SINK_BLOCK_SIZE ? needed : OUTPUT_SINK_BLOCK_SIZE;
+    if (block->size < size) {
+        char* data = realloc(block->data, size);
+        if (data == NULL) {
+            fprintf(stderr, "Error: Failed to allocate output sink block.\n");
+            return NULL;
+        }
+        block->data = data;
+        block->size = size;
+    }
+    block->used = 0;
+    sink->block_count++;
+    return block;
+}
+
+static void* timer_thread(void* arg)
+{
+    output_sink_t* sink = arg;
+
+    pthread_mutex_lock(&sink->mutex);
+    while (!sink->closing) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += sink->flush.interval_ms / 1000;
+        deadline.tv_nsec += (sink->flush.interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while (!sink->closing && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&sink->wake, &sink->mutex, &deadline);
+        }
+        if (!sink->closing) {
+            flush_locked(sink);
+        }
+    }
+    pthread_mutex_unlock(&sink->mutex);
+    return NULL;
+}
+
+int output_sink_open(output_sink_t* sink, const char* target, const output_sink_flush_t* flush)
+{
+    if (sink == NULL || target == NULL || flush == NULL) {
+        fprintf(stderr, "Error: output_sink_open received NULL.\n");
+        return -1;
+    }
+
+    memset(sink, 0, sizeof(*sink));
+    sink->flush = *flush;
+
+    if (strcmp(target, "stdout") == 0) {
+        sink->fd = STDOUT_FILENO;
+    } else if (strncmp(target, "file:", 5) == 0 && target[5] != '\0') {
+        sink->fd = open(target + 5, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (sink->fd < 0) {
+            return -1;
+        }
+        sink->owns_fd = 1;
+    } else if (strncmp(target, "fd:", 3) == 0 && target[3] != '\0') {
+        char* end = NULL;
+        long fd = strtol(target + 3, &end, 10);
+        if (*end != '\0' || fd < 0 || fcntl((int)fd, F_GETFD) < 0) {
+            return -1;
+        }
+        sink->fd = (int)fd;
+    } else {
+        return -1;
+    }
+
+    pthread_mutex_init(&sink->mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sink->wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (!sink->flush.every_line && sink->flush.interval_ms > 0) {
+        if (pthread_create(&sink->timer_thread, NULL, timer_thread, sink) != 0) {
+            fprintf(stderr, "Error: Failed to start output sink timer.\n");
+            output_sink_close(sink);
+            return -1;
+        }
+        sink->timer_running = 1;
+    }
+    return 0;
+}
+
+int output_sink_write(output_sink_t* sink, const char* data, size_t len)
+{
+    pthread_mutex_lock(&sink->mutex);
+    if (sink->error) {
+        pthread_mutex_unlock(&sink->mutex);
+        return -1;
+    }
+
+    int rc = 0;
+    output_sink_block_t* block = block_for(sink, len + 1);
+    if (block == NULL) {
+        rc = -1;
+    } else {
+        memcpy(block->data + block->used, data, len);
+        block->data[block->used + len] = '\n';
+        block->used += len + 1;
+        sink->buffered += len + 1;
+
+        if (sink->flush.every_line || (sink->flush.bytes > 0 && sink->buffered >= sink->flush.bytes)) {
+            rc = flush_locked(sink);
+        }
+    }
+    pthread_mutex_unlock(&sink->mutex);
+    return rc;
+}
+
+int output_sink_flush(output_sink_t* sink)
+{
+    pthread_mutex_lock(&sink->mutex);
+    int rc = flush_locked(sink);
+    pthread_mutex_unlock(&sink->mutex);
+    return rc;
+}
+
+int output_sink_close(output_sink_t* sink)
+{
+    if (sink == NULL) {
+        fprintf(stderr, "Error: output_sink_close received NULL.\n");
+        return -1;
+    }
+
+    if (sink->timer_running) {
+        pthread_mutex_lock(&sink->mutex);
+        sink->closing = 1;
+        pthread_cond_signal(&sink->wake);
+        pthread_mutex_unlock(&sink->mutex);
+        pthread_join(sink->timer_thread, NULL);
+        sink->timer_running = 0;
+    }
+
+    int rc = output_sink_flush(sink);
+
+    for (int i = 0; i < OUTPUT_SINK_MAX_BLOCKS; ++i) {
+        free(sink->blocks[i].data);
+        sink->blocks[i].data = NULL;
+        sink->blocks[i].size = 0;
+    }
+    if (sink->owns_fd) {
+        close(sink->fd);
+        sink->owns_fd = 0;
+    }
+    pthread_cond_destroy(&sink->wake);
+    pthread_mutex_destroy(&sink->mutex);
+    return rc;
+}
@@ -0,0 +1,85 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define OUTPUT_SINK_BLOCK_SIZE (64 * 1024) // Arena block size
+#define OUTPUT_SINK_MAX_BLOCKS 64 // Blocks per writev (well under IOV_MAX)
+#define OUTPUT_SINK_DEFAULT_FLUSH_BYTES (256 * 1024)
+#define OUTPUT_SINK_DEFAULT_FLUSH_MS 100
+
+// When buffered results are written out (the sink always flushes when it is closed)
+typedef struct
+{
+    int every_line; // Write each result as it arrives (like logger)
+    size_t bytes; // Write once this much is buffered, 0 = no size trigger
+    long interval_ms; // Write whatever is buffered at least this often, 0 = no timer
+} output_sink_flush_t;
+
+// One arena block - results are copied back to back, each followed by '\n'
+typedef struct
+{
+    char* data;
+    size_t size;
+    size_t used;
+} output_sink_block_t;
+
+// Collects the last stage's results and writes them with writev over arena blocks
+typedef struct
+{
+    int fd; // Destination
+    int owns_fd; // Opened from file:<path>, closed by output_sink_close
+    output_sink_flush_t flush; // Flush policy
+    output_sink_block_t blocks[OUTPUT_SINK_MAX_BLOCKS];
+    int block_count; // Blocks holding data (the last one is being filled)
+    size_t buffered; // Bytes waiting across all blocks
+    pthread_mutex_t mutex; // The last stage's thread and the timer both flush
+    pthread_cond_t wake; // Stops the timer thread
+    pthread_t timer_thread;
+    int timer_running;
+    int closing;
+    int error; // A write failed - further results are dropped
+} output_sink_t;
+
+/**
+* Parse a flush policy: "every", "end", or comma separated "bytes:<N>" and "ms:<N>"
+* @param spec Policy text
+* @param flush Filled with the policy
+* @return 0 on success, -1 if spec is invalid
+*/
+int output_sink_parse_flush(const char* spec, output_sink_flush_t* flush);
+
+/**
+* Open a sink on "stdout", "file:<path>" (created/truncated) or "fd:<n>"
+* @param sink Pointer to sink structure
+* @param target Where results go
+* @param flush Flush policy
+* @return 0 on success, -1 on failure
+*/
+int output_sink_open(output_sink_t* sink, const char* target, const output_sink_flush_t* flush);
+
+/**
+* Buffer one result (a '\n' is added), writing out according to the flush policy
+* @param sink Pointer to sink structure
+* @param data Result bytes
+* @param len Number of bytes
+* @return 0 on success, -1 on write failure
+*/
+int output_sink_write(output_sink_t* sink, const char* data, size_t len);
+
+/**
+* Write out everything buffered
+* @param sink Pointer to sink structure
+* @return 0 on success, -1 on write failure
+*/
+int output_sink_flush(output_sink_t* sink);
+
+/**
+* Flush, stop the timer and release the sink (closes fds it opened)
+* @param sink Pointer to sink structure
+* @return 0 on success, -1 if any write failed
+*/
+int output_sink_close(output_sink_t* sink);
+
+#endif // OUTPUT_SINK_H
@@ -0,0 +1,193 @@
+#include "readahead.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void block_reset(readahead_block_t* block)
+{
+    block->used = 0;
+    block->count = 0;
+}
+
+static void block_free(readahead_block_t* block)
+{
+    free(block->data);
+    free(block->lines);
+    memset(block, 0, sizeof(*block));
+}
+
+static int block_full(const readahead_t* ahead, const readahead_block_t* block)
+{
+    // A single long line is always accepted into an empty block
+    return block->count >= ahead->max_lines ||
+           (block->count > 0 && block->used >= READAHEAD_MAX_BYTES);
+}
+
+static int block_append(readahead_block_t* block, const char* line, size_t len)
+{
+    if (block->used + len + 1 > block->capacity) {
+        size_t capacity = block->capacity ? block->capacity : 64 * 1024;
+        while (capacity < block->used + len + 1) capacity *= 2;
+        char* grown = realloc(block->data, capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        block->data = grown;
+        block->capacity = capacity;
+    }
+    if (block->count == block->line_capacity) {
+        size_t capacity = block->line_capacity ? block->line_capacity * 2 : 256;
+        readahead_line_t* grown = realloc(block->lines, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            return -1;
+        }
+        block->lines = grown;
+        block->line_capacity = capacity;
+    }
+
+    memcpy(block->data + block->used, line, len);
+    block->data[block->used + len] = '\0';
+    block->lines[block->count].offset = block->used;
+    block->lines[block->count].len = len;
+    block->count++;
+    block->used += len + 1;
+    return 0;
+}
+
+static void* reader_thread(void* arg)
+{
+    readahead_t* ahead = arg;
+    const char* line;
+    size_t len;
+    int rc;
+    int failed = 0;
+
+    while ((rc = input_source_next(ahead->source, &line, &len)) > 0) {
+        // Reading past "<END>" could block on a stream nobody will ever finish
+        if (input_source_is_end(line, len)) {
+            break;
+        }
+
+        pthread_mutex_lock(&ahead->mutex);
+        while (block_full(ahead, ahead->fill) && !ahead->stop) {
+            pthread_cond_wait(&ahead->drained, &ahead->mutex);
+        }
+        if (ahead->stop) {
+            pthread_mutex_unlock(&ahead->mutex);
+            break;
+        }
+        // Copying under the lock is fine - the consumer only takes it to swap blocks
+        if (block_append(ahead->fill, line, len) != 0) {
+            fprintf(stderr, "Error: Failed to allocate read-ahead buffer.\n");
+            failed = 1;
+            pthread_mutex_unlock(&ahead->mutex);
+            break;
+        }
+        if (ahead->fill->count == 1) {
+            pthread_cond_signal(&ahead->filled);
+        }
+        pthread_mutex_unlock(&ahead->mutex);
+    }
+
+    pthread_mutex_lock(&ahead->mutex);
+    ahead->done = 1;
+    ahead->error = rc < 0 || failed;
+    pthread_cond_signal(&ahead->filled);
+    pthread_mutex_unlock(&ahead->mutex);
+    return NULL;
+}
+
+int readahead_start(readahead_t* ahead, input_source_t* source, size_t lines)
+{
+    if (ahead == NULL || source == NULL) {
+        fprintf(stderr, "Error: readahead_start received NULL.\n");
+        return -1;
+    }
+
+    memset(ahead, 0, sizeof(*ahead));
+    ahead->source = source;
+    if (lines == 0) {
+        return 0;
+    }
+
+    // Half the lines fill while the other half is consumed
+    ahead->max_lines = lines > 1 ? lines / 2 : 1;
+    ahead->fill = &ahead->blocks[0];
+    ahead->drain = &ahead->blocks[1];
+    pthread_mutex_init(&ahead->mutex, NULL);
+    pthread_cond_init(&ahead->filled, NULL);
+    pthread_cond_init(&ahead->drained, NULL);
+
+    if (pthread_create(&ahead->thread, NULL, reader_thread, ahead) != 0) {
+        fprintf(stderr, "Error: Failed to create read-ahead thread.\n");
+        pthread_mutex_destroy(&ahead->mutex);
+        pthread_cond_destroy(&ahead->filled);
+        pthread_cond_destroy(&ahead->drained);
+        return -1;
+    }
+    ahead->started = 1;
+    return 0;
+}
+
+int readahead_next(readahead_t* ahead, const char** line, size_t* len)
+{
+    if (!ahead->started) {
+        int rc = input_source_next(ahead->source, line, len);
+        if (rc > 0 && input_source_is_end(*line, *len)) {
+            return 0;
+        }
+        return rc;
+    }
+
+    if (ahead->next == ahead->drain->count) {
+        pthread_mutex_lock(&ahead->mutex);
+        while (ahead->fill->count == 0 && !ahead->done) {
+            pthread_cond_wait(&ahead->filled, &ahead->mutex);
+        }
+        if (ahead->fill->count == 0) {
+            int error = ahead->error;
+            pthread_mutex_unlock(&ahead->mutex);
+            return error ? -1 : 0;
+        }
+
+        // Take everything read so far in one go; the reader continues in the old block
+        readahead_block_t* taken = ahead->fill;
+        ahead->fill = ahead->drain;
+        ahead->drain = taken;
+        block_reset(ahead->fill);
+        pthread_cond_signal(&ahead->drained);
+        pthread_mutex_unlock(&ahead->mutex);
+        ahead->next = 0;
+    }
+
+    const readahead_line_t* entry = &ahead->drain->lines[ahead->next++];
+    *line = ahead->drain->data + entry->offset;
+    *len = entry->len;
+    return 1;
+}
+
+void readahead_stop(readahead_t* ahead)
+{
+    if (ahead == NULL) {
+        fprintf(stderr, "Error: readahead_stop received NULL.\n");
+        return;
+    }
+    if (!ahead->started) {
+        return;
+    }
+
+    // A reader blocked in read() is only joined once that read returns
+    pthread_mutex_lock(&ahead->mutex);
+    ahead->stop = 1;
+    pthread_cond_signal(&ahead->drained);
+    pthread_mutex_unlock(&ahead->mutex);
+    pthread_join(ahead->thread, NULL);
+
+    block_free(&ahead->blocks[0]);
+    block_free(&ahead->blocks[1]);
+    pthread_mutex_destroy(&ahead->mutex);
+    pthread_cond_destroy(&ahead->filled);
+    pthread_cond_destroy(&ahead->drained);
+    ahead->started = 0;
+}
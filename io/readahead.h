@@ -0,0 +1,77 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "input_source.h"
+
+#define READAHEAD_DEFAULT_LINES 4096 // Lines read ahead of the first stage (--readahead)
+#define READAHEAD_MAX_BYTES (4 * 1024 * 1024) // Per half - long lines stop read-ahead early
+
+// Where in a block one line's bytes are
+typedef struct
+{
+    size_t offset;
+    size_t len;
+} readahead_line_t;
+
+// Copied lines, back to back and '\0' terminated
+typedef struct
+{
+    char* data;
+    size_t used;
+    size_t capacity;
+    readahead_line_t* lines;
+    size_t count;
+    size_t line_capacity;
+} readahead_block_t;
+
+// Reads and splits an input on its own thread, ahead of the consumer
+// The reader appends to one block while the consumer walks the other; they swap
+// when the consumer runs dry, so the reader only stalls when a whole block is
+// waiting (the consumer is that far behind)
+typedef struct
+{
+    input_source_t* source; // Not owned
+    size_t max_lines; // Lines per block
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t filled; // Reader added a line or finished
+    pthread_cond_t drained; // Consumer took the filled block
+    readahead_block_t blocks[2];
+    readahead_block_t* fill; // Reader side
+    readahead_block_t* drain; // Consumer side
+    size_t next; // Next line of drain
+    int done; // Reader reached the end of input (or "<END>")
+    int error; // Reader hit a read error or a bad frame
+    int stop; // Consumer is going away
+    int started; // Reader thread is running; otherwise lines come straight from source
+} readahead_t;
+
+/**
+* Start reading a source ahead of the caller
+* The reader stops at end of input or at a "<END>" line (which is not returned),
+* so it never blocks on a stream the pipeline is already done with
+* @param ahead Pointer to read-ahead structure
+* @param source Opened source, read only through ahead from now on
+* @param lines Lines to buffer, 0 reads synchronously on the caller's thread
+* @return 0 on success, -1 on failure
+*/
+int readahead_start(readahead_t* ahead, input_source_t* source, size_t lines);
+
+/**
+* Return the next line, same contract as input_source_next
+* @param ahead Pointer to read-ahead structure
+* @param line Set to the start of the line
+* @param len Set to the length of the line
+* @return 1 if a line was returned, 0 at end of input, -1 on read error or a bad frame
+*/
+int readahead_next(readahead_t* ahead, const char** line, size_t* len);
+
+/**
+* Stop and join the reader, free the buffers (does not close the source)
+* @param ahead Pointer to read-ahead structure
+*/
+void readahead_stop(readahead_t* ahead);
+
+#endif // READAHEAD_H
@@ -0,0 +1,88 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define IO_ENGINE_ENV "ANALYZER_IO_ENGINE" // "sync" (default) or "uring", set by --io-engine
+
+// Minimal io_uring wrapper on the raw syscalls (no liburing dependency)
+// One ring is only ever driven by a single thread
+typedef struct
+{
+    int fd; // Ring file descriptor, -1 if not set up
+    unsigned entries; // Submission queue size
+    unsigned* sq_head; // Kernel consumed up to here
+    unsigned* sq_tail; // Published submissions
+    unsigned* sq_mask;
+    unsigned* sq_array; // Index indirection into sqes
+    unsigned sqe_tail; // Local tail - sqes handed out but not yet published
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head; // We consumed up to here
+    unsigned* cq_tail; // Kernel produced up to here
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ring; // Mappings, for teardown
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    int buffers_registered; // uring_register_buffers succeeded
+} uring_t;
+
+/**
+* Check whether the io engine selected through ANALYZER_IO_ENGINE is io_uring
+* @return 1 for "uring", 0 for "sync" or unset, -1 for anything else
+*/
+int uring_engine_requested(void);
+
+/**
+* Set up a ring
+* Fails (e.g. ENOSYS, EPERM) on kernels or sandboxes without io_uring - callers fall back to read/write
+* @param ring Pointer to ring structure
+* @param entries Submission queue size
+* @return 0 on success, -1 on failure
+*/
+int uring_init(uring_t* ring, unsigned entries);
+
+/**
+* Unmap and close the ring (pending operations are abandoned)
+* @param ring Pointer to ring structure
+*/
+void uring_destroy(uring_t* ring);
+
+/**
+* Register fixed buffers for IORING_OP_READ_FIXED / WRITE_FIXED
+* @param ring Pointer to ring structure
+* @param iov Buffers to register
+* @param count Number of buffers
+* @return 0 on success, -1 on failure (plain READ/WRITE still work)
+*/
+int uring_register_buffers(uring_t* ring, const struct iovec* iov, unsigned count);
+
+/**
+* Get a cleared submission entry
+* @param ring Pointer to ring structure
+* @return Entry to fill in, NULL if the submission queue is full
+*/
+struct io_uring_sqe* uring_get_sqe(uring_t* ring);
+
+/**
+* Submit everything prepared since the last call, optionally waiting for completions
+* All prepared entries go to the kernel in one io_uring_enter
+* @param ring Pointer to ring structure
+* @param wait_nr Number of completions to wait for
+* @return 0 on success, -1 on failure (including the kernel taking no entries)
+*/
+int uring_submit(uring_t* ring, unsigned wait_nr);
+
+/**
+* Take the next completion, waiting for one if none is ready
+* @param ring Pointer to ring structure
+* @param cqe Filled with the completion
+* @return 0 on success, -1 on failure
+*/
+int uring_wait_cqe(uring_t* ring, struct io_uring_cqe* cqe);
+
+#endif // URING_H
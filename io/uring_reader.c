@@ -0,0 +1,229 @@
+#define _GNU_SOURCE
+#include "uring_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+
+int uring_reader_init(uring_reader_t* reader, int fd)
+{
+    if (reader == NULL) {
+        fprintf(stderr, "Error: uring_reader_init received NULL.\n");
+        return -1;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+    reader->buffer_size = URING_READER_BUFFER_SIZE;
+
+    if (uring_init(&reader->ring, URING_READER_DEPTH * 2) != 0) {
+        return -1;
+    }
+
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    reader->seekable = (position >= 0);
+    reader->next_offset = reader->seekable ? position : 0;
+
+    struct iovec iov[URING_READER_DEPTH];
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        reader->buffers[i] = aligned_alloc(4096, reader->buffer_size);
+        if (reader->buffers[i] == NULL) {
+            uring_reader_destroy(reader);
+            return -1;
+        }
+        iov[i].iov_base = reader->buffers[i];
+        iov[i].iov_len = reader->buffer_size;
+    }
+
+    // Without registration (e.g. RLIMIT_MEMLOCK) plain READ still works
+    uring_register_buffers(&reader->ring, iov, URING_READER_DEPTH);
+    return 0;
+}
+
+static int in_flight_count(uring_reader_t* reader)
+{
+    int n = 0;
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        if (reader->state[i] == URING_BUFFER_IN_FLIGHT) n++;
+    }
+    return n;
+}
+
+// Cancel every read still in flight and wait for each one's completion, so
+// the kernel no longer writes into the buffers; returns -1 if that failed
+static int reap_in_flight(uring_reader_t* reader)
+{
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        if (reader->state[i] != URING_BUFFER_IN_FLIGHT) continue;
+        struct io_uring_sqe* sqe = uring_get_sqe(&reader->ring);
+        if (sqe == NULL) break; // The read still completes, just later
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (uint64_t)i; // user_data of the read to cancel
+        sqe->user_data = URING_READER_DEPTH; // Not a buffer index
+    }
+    if (uring_submit(&reader->ring, 0) != 0) {
+        return -1;
+    }
+
+    while (in_flight_count(reader) > 0) {
+        struct io_uring_cqe cqe;
+        if (uring_wait_cqe(&reader->ring, &cqe) != 0) {
+            return -1;
+        }
+        if (cqe.user_data < URING_READER_DEPTH) {
+            reader->state[cqe.user_data] = URING_BUFFER_IDLE; // Done or cancelled
+        }
+    }
+    return 0;
+}
+
+void uring_reader_destroy(uring_reader_t* reader)
+{
+    if (reader == NULL) {
+        fprintf(stderr, "Error: uring_reader_destroy received NULL.\n");
+        return;
+    }
+
+    // Closing the ring does not stop reads the kernel already started, so the
+    // buffers may only go once every read has completed
+    if (in_flight_count(reader) > 0 && reap_in_flight(reader) != 0) {
+        fprintf(stderr, "Error: Failed to cancel io_uring reads, keeping their buffers.\n");
+        uring_destroy(&reader->ring);
+        return;
+    }
+    uring_destroy(&reader->ring);
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        free(reader->buffers[i]);
+        reader->buffers[i] = NULL;
+    }
+}
+
+// Queue reads into every idle buffer (only one at a time on pipes)
+static int submit_reads(uring_reader_t* reader)
+{
+    int queued = 0;
+    for (int i = 0; i < URING_READER_DEPTH && !reader->eof; ++i) {
+        if (reader->state[i] != URING_BUFFER_IDLE) continue;
+        if (!reader->seekable && in_flight_count(reader) + queued > 0) break;
+
+        struct io_uring_sqe* sqe = uring_get_sqe(&reader->ring);
+        if (sqe == NULL) break;
+
+        sqe->opcode = reader->ring.buffers_registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = reader->fd;
+        sqe->addr = (uint64_t)(uintptr_t)reader->buffers[i];
+        sqe->len = (unsigned)reader->buffer_size;
+        sqe->off = reader->seekable ? (uint64_t)reader->next_offset : (uint64_t)-1;
+        sqe->buf_index = (uint16_t)i;
+        sqe->user_data = (uint64_t)i;
+
+        reader->state[i] = URING_BUFFER_IN_FLIGHT;
+        reader->sequence[i] = reader->next_submit++;
+        reader->generation[i] = reader->current_generation;
+        reader->offset[i] = reader->next_offset;
+        reader->consumed[i] = 0;
+        if (reader->seekable) {
+            reader->next_offset += (off_t)reader->buffer_size;
+        }
+        queued++;
+    }
+
+    // One syscall for the whole batch
+    return queued ? uring_submit(&reader->ring, 0) : 0;
+}
+
+static int find_sequence(uring_reader_t* reader, uint64_t sequence)
+{
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        if (reader->state[i] != URING_BUFFER_IDLE && reader->sequence[i] == sequence &&
+            reader->generation[i] == reader->current_generation) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Restart reading at offset: data already read ahead is dropped, and reads
+// still in flight are discarded when they complete
+static void restart_at(uring_reader_t* reader, off_t offset)
+{
+    for (int i = 0; i < URING_READER_DEPTH; ++i) {
+        if (reader->state[i] == URING_BUFFER_READY) reader->state[i] = URING_BUFFER_IDLE;
+    }
+    reader->next_offset = offset;
+    reader->next_submit = reader->next_consume;
+    reader->current_generation++;
+}
+
+// Wait until the buffer holding the next sequence number is READY
+// Returns its index, -2 at end of input, -1 on error
+static int wait_next(uring_reader_t* reader)
+{
+    while (1) {
+        int index = find_sequence(reader, reader->next_consume);
+        if (index >= 0 && reader->state[index] == URING_BUFFER_READY) {
+            return index;
+        }
+        if (index < 0) {
+            if (submit_reads(reader) != 0) return -1;
+            if (find_sequence(reader, reader->next_consume) < 0 && in_flight_count(reader) == 0) {
+                return -2;
+            }
+        }
+
+        struct io_uring_cqe cqe;
+        if (uring_wait_cqe(&reader->ring, &cqe) != 0) return -1;
+
+        int done = (int)cqe.user_data;
+        if (reader->generation[done] != reader->current_generation) {
+            reader->state[done] = URING_BUFFER_IDLE; // stale read-ahead
+            continue;
+        }
+        reader->state[done] = URING_BUFFER_READY;
+        reader->result[done] = cqe.res;
+    }
+}
+
+ssize_t uring_reader_read(void* ctx, char* dst, size_t len)
+{
+    uring_reader_t* reader = ctx;
+    while (1) {
+        int index = wait_next(reader);
+        if (index == -2) return 0;
+        if (index < 0) return -1;
+
+        ssize_t result = reader->result[index];
+        if (result == -EINTR || result == -EAGAIN) {
+            restart_at(reader, reader->offset[index]); // retry the same range
+            continue;
+        }
+        if (result < 0) {
+            errno = (int)-result;
+            return -1;
+        }
+
+        if (result == 0) {
+            reader->eof = 1;
+            restart_at(reader, reader->offset[index]); // anything further out is past the end
+            return 0;
+        }
+
+        size_t available = (size_t)result - reader->consumed[index];
+        size_t n = available < len ? available : len;
+        memcpy(dst, reader->buffers[index] + reader->consumed[index], n);
+        reader->consumed[index] += n;
+
+        if (reader->consumed[index] == (size_t)result) {
+            reader->state[index] = URING_BUFFER_IDLE;
+            reader->next_consume++;
+            if (reader->seekable && (size_t)result < reader->buffer_size) {
+                // Short read: reads queued behind it started at the wrong offset
+                restart_at(reader, reader->offset[index] + result);
+            }
+            submit_reads(reader); // refill while the caller parses
+        }
+        return (ssize_t)n;
+    }
+}
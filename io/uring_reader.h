@@ -0,0 +1,67 @@
+#ifndef URING_READER_H
+#define URING_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "uring.h"
+
+#define URING_READER_DEPTH 4 // Reads kept in flight on seekable files
+#define URING_READER_BUFFER_SIZE (256 * 1024)
+
+// State of one registered buffer
+typedef enum
+{
+    URING_BUFFER_IDLE,
+    URING_BUFFER_IN_FLIGHT,
+    URING_BUFFER_READY,
+} uring_buffer_state_t;
+
+// Reads a descriptor through io_uring into registered buffers
+// Seekable files keep URING_READER_DEPTH reads in flight at increasing offsets,
+// all submitted with one io_uring_enter; pipes keep a single read in flight
+typedef struct
+{
+    uring_t ring;
+    int fd; // Input descriptor (not owned)
+    int seekable; // Reads carry explicit offsets
+    off_t next_offset; // Offset of the next read to submit
+    size_t buffer_size;
+    char* buffers[URING_READER_DEPTH]; // Registered buffers
+    uring_buffer_state_t state[URING_READER_DEPTH];
+    uint64_t sequence[URING_READER_DEPTH]; // Submission order, so data is consumed in file order
+    uint64_t generation[URING_READER_DEPTH]; // Reads of an older generation are discarded
+    off_t offset[URING_READER_DEPTH]; // File offset each buffer was read from
+    ssize_t result[URING_READER_DEPTH]; // Bytes read (or -errno)
+    size_t consumed[URING_READER_DEPTH]; // Bytes of a READY buffer already handed out
+    uint64_t next_submit; // Sequence number for the next submission
+    uint64_t next_consume; // Sequence number that must be consumed next
+    uint64_t current_generation; // Bumped when in-flight reads become invalid (short read)
+    int eof;
+} uring_reader_t;
+
+/**
+* Set up a ring and registered buffers for fd
+* @param reader Pointer to reader structure
+* @param fd Descriptor to read
+* @return 0 on success, -1 if io_uring is unavailable (use read() instead)
+*/
+int uring_reader_init(uring_reader_t* reader, int fd);
+
+/**
+* Release the ring and buffers (does not close fd)
+* @param reader Pointer to reader structure
+*/
+void uring_reader_destroy(uring_reader_t* reader);
+
+/**
+* read()-like: copy up to len bytes of input into dst
+* Matches line_reader_read_fn so it can feed a line_reader
+* @param ctx Pointer to reader structure
+* @param dst Destination
+* @param len Space in dst
+* @return Bytes copied, 0 at end of input, -1 on error
+*/
+ssize_t uring_reader_read(void* ctx, char* dst, size_t len);
+
+#endif // URING_READER_H
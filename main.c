@@ -1,19 +1,43 @@
 #include "main.h"
+#include "io/input_source.h"
+#include "io/output_sink.h"
+#include "io/input_group.h"
+#include "io/readahead.h"
+#include "io/daemon_server.h"
+#include "io/metrics_exporter.h"
+#include "plugins/chunk/chunk.h"
+#include "plugins/registry/static_registry.h"
+#include "plugins/stats/stage_stats.h"
+#include "plugins/stats/latency_histogram.h"
+#include "plugins/stats/trace.h"
+#include "plugins/sync/consumer_producer.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include <dlfcn.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <malloc.h>
 
 
 
 typedef const char* (*plugin_init_func_t)(int);
 typedef const char* (*plugin_fini_func_t)(void);
 typedef const char* (*plugin_place_work_func_t)(const char*);
+typedef const char* (*plugin_place_work_n_func_t)(const char*, size_t);
 typedef void (*plugin_attach_func_t)(const char* (*)(const char*));
 typedef const char* (*plugin_wait_finished_func_t)(void);
+typedef const char* (*plugin_transform_func_t)(const char*);
+typedef const char* (*plugin_swap_transform_func_t)(plugin_transform_func_t);
+typedef const char* (*plugin_get_stats_func_t)(stage_stats_t*);
+typedef const char* (*plugin_get_latency_func_t)(stage_latency_t*);
+typedef const char* (*plugin_get_queue_depth_func_t)(int*, int*);
 
 
 
@@ -22,13 +46,153 @@ typedef struct {
     plugin_init_func_t init;
     plugin_fini_func_t fini;
     plugin_place_work_func_t place_work;
+    plugin_place_work_n_func_t place_work_n; // Optional - NULL for plugins built before it existed
     plugin_attach_func_t attach;
     plugin_wait_finished_func_t wait_finished;
+    plugin_swap_transform_func_t swap_transform; // Optional - NULL for plugins built before it existed
+    plugin_get_stats_func_t get_stats; // Optional - NULL for plugins built before it existed
+    plugin_get_latency_func_t get_latency; // Optional - NULL for plugins built before it existed
+    plugin_get_queue_depth_func_t get_queue_depth; // Optional - NULL for plugins built before it existed
     char* name;
-    void* handle;
+    void* handle; // NULL for built-in plugins
+    struct stat so_stat; // output/<name>.so as of the last (re)load, zeroed if there was none
+    void* swap_handle; // Copy of a newer build whose transform the stage runs now (--hot-swap)
+    plugin_fini_func_t swap_fini; // ... finalized after the stage itself
+    int builtin; // Linked into the analyzer (see plugins/registry)
+    double load_ms; // Startup time spent resolving this stage
+    double init_ms; // ... and in its plugin_init
 } plugin_handle_t;
 
+#define STARTUP_THREADS 8 // Threads loading and initializing stages
+
+// Where plugins (<name>.so) are looked up, relative to the working directory;
+// build.sh points release/lto/pgo builds at their own output/<type>
+#ifndef ANALYZER_PLUGIN_DIR
+#define ANALYZER_PLUGIN_DIR "output"
+#endif
+
+// Wall time of each startup phase, for --timings
+typedef struct {
+    double load_ms;
+    double init_ms;
+    double attach_ms;
+} startup_timings_t;
+
+// --hot-swap: SIGHUP reloads stages whose .so changed, on a thread of its own
+typedef struct {
+    plugin_handle_t* plugins;
+    int plugin_count;
+    int queue_size;
+    pthread_t thread;
+    pthread_mutex_t mutex; // Held during a reload; shutdown takes it to stop reloads
+    int stopping;
+    int running;
+    int swaps; // Reloads done, numbers the temporary copies
+} hot_swap_t;
+
+// SIGUSR1 prints the stage counters and latencies while the pipeline runs, on a thread of its own
+typedef struct {
+    plugin_handle_t* plugins;
+    int plugin_count;
+    pthread_t thread;
+    int stopping; // Set before the final SIGUSR1 that ends the thread
+    int running;
+} stats_reporter_t;
+
+#define OCCUPANCY_SAMPLE_MS 10 // --bottleneck sampling period
+#define OCCUPANCY_MAX_REPLICAS 64 // Cap on the suggested replica count
+
+// What the --bottleneck sampler saw of one stage's input queue
+typedef struct {
+    uint64_t fill_sum; // Items waiting, summed over the samples
+    uint64_t full; // Samples with the queue full
+    uint64_t empty; // Samples with the queue empty
+    uint64_t bottleneck; // Samples with the queue full and the next stage's empty
+    int capacity;
+} stage_occupancy_t;
+
+// --bottleneck: every queue's fill sampled on a thread of its own
+typedef struct {
+    plugin_handle_t* plugins;
+    int plugin_count;
+    stage_occupancy_t* stages;
+    int* counts; // Current sample, -1 for a stage without plugin_get_queue_depth
+    uint64_t samples;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    pthread_t thread;
+    int stopping;
+    int running;
+} occupancy_sampler_t;
+
+// What --metrics renders from
+typedef struct {
+    plugin_handle_t* plugins;
+    int plugin_count;
+    uint64_t start_ns;
+} metrics_source_t;
+
+// Command line options (everything before <queue_size>)
+typedef struct {
+    const char** inputs; // --input values in order, none reads stdin
+    int input_count;
+    input_group_options_t group; // --readers / --ordered, used with several inputs
+    input_framing_t framing; // --framing, lines by default
+    int chunk_lines; // --chunk-lines, lines packed per queue message (1 = no chunks)
+    int readahead_lines; // --readahead, lines read ahead of the first stage (0 = off)
+    int timings; // --timings, print where startup time went
+    int hot_swap; // --hot-swap, reload changed plugins on SIGHUP
+    int stats; // --stats, print the stage counters at shutdown
+    int latency; // --latency, print the stage latency percentiles at shutdown
+    int bottleneck; // --bottleneck, sample queue fill and name the slowest stage at shutdown
+    const char* metrics_target; // --metrics, http:<port> or file:<path>
+    long metrics_interval_ms; // --metrics-interval, file: rewrite period
+    const char* trace_path; // --trace, write sampled message spans here at shutdown
+    int trace_sample; // --trace-sample, trace one message in this many
+    const char* daemon_path; // --daemon, serve clients on this socket instead of reading input
+    const char* connect_path; // --connect, send stdin to a daemon instead of running a pipeline
+    const char* sink_target; // --sink, NULL leaves the last stage's output unused
+    output_sink_flush_t sink_flush; // --sink-flush
+} analyzer_options_t;
+
+// Long options without a short form
+enum {
+    OPT_IO_ENGINE = 256,
+    OPT_FRAMING,
+    OPT_SINK,
+    OPT_SINK_FLUSH,
+    OPT_READERS,
+    OPT_ORDERED,
+    OPT_CHUNK_LINES,
+    OPT_READAHEAD,
+    OPT_TIMINGS,
+    OPT_DAEMON,
+    OPT_CONNECT,
+    OPT_HOT_SWAP,
+    OPT_STATS,
+    OPT_LATENCY,
+    OPT_TRACE,
+    OPT_TRACE_SAMPLE,
+    OPT_BOTTLENECK,
+    OPT_METRICS,
+    OPT_METRICS_INTERVAL,
+};
+
+// Built-in final stage: the last plugin forwards its results here
+static output_sink_t sink;
+static chunk_view_t sink_chunk; // Only used on the last plugin's thread
+
+// Lines waiting to be placed as one chunk (shared by reader threads)
+typedef struct {
+    plugin_handle_t* first_plugin;
+    int chunk_lines;
+    chunk_builder_t builder;
+    uint64_t first_line_ns; // Ingest time of the oldest line in builder
+    pthread_mutex_t mutex;
+} line_batch_t;
+
 //Function decleration
+int parse_options(int argc, char** argv, analyzer_options_t* options);
 int check_valid_args(int argc, char** argv);
 int is_arg_starts_with_number(const char* str);
 int is_valid_plugin_name(const char* name);
@@ -36,8 +200,31 @@ int are_valid_plugins(int argc, char** argv);
 void print_usage(void);
 plugin_handle_t* create_plugins_handle(char** plugin_names, int plugin_count, int queue_size);
 void init_all_plugins(plugin_handle_t* plugins, int plugin_count, int queue_size);
-void attach_all_plugins(plugin_handle_t* plugins, int plugin_count);
-void iterate_input_over_plugins(plugin_handle_t* first_plugin); 
+void attach_all_plugins(plugin_handle_t* plugins, int plugin_count, const char* (*last_next)(const char*));
+void run_stage_jobs(void (*job)(void* ctx, int index), void* ctx, int count);
+double elapsed_ms(const struct timespec* since);
+void print_startup_timings(const plugin_handle_t* plugins, int plugin_count, const startup_timings_t* timings);
+int copy_file(const char* from, const char* to);
+void hot_swap_start(hot_swap_t* swap, plugin_handle_t* plugins, int plugin_count, int queue_size);
+void hot_swap_stop(hot_swap_t* swap);
+void reload_changed_plugins(hot_swap_t* swap);
+void print_stage_stats(const plugin_handle_t* plugins, int plugin_count);
+void print_stage_latency(const plugin_handle_t* plugins, int plugin_count);
+void stats_reporter_start(stats_reporter_t* reporter, plugin_handle_t* plugins, int plugin_count);
+void stats_reporter_stop(stats_reporter_t* reporter);
+void occupancy_sampler_start(occupancy_sampler_t* sampler, plugin_handle_t* plugins, int plugin_count);
+void occupancy_sampler_stop(occupancy_sampler_t* sampler);
+void print_bottleneck_report(const occupancy_sampler_t* sampler);
+void render_metrics(FILE* out, void* ctx);
+const char* sink_place_work(const char* str);
+int iterate_input_over_plugins(line_batch_t* batch, input_source_t* source, int readahead_lines);
+int iterate_inputs_over_plugins(line_batch_t* batch, const analyzer_options_t* options);
+void serve_clients_over_plugins(line_batch_t* batch, daemon_server_t* server, input_framing_t framing);
+int flush_shared_batch(void* ctx);
+int deliver_line(void* ctx, const char* line, size_t len);
+const char* flush_batch(line_batch_t* batch);
+void place_end(plugin_handle_t* first_plugin);
+const char* place_line(plugin_handle_t* plugin, const char* line, size_t len);
 void wait_for_all_plugins_to_finish(plugin_handle_t* plugins, int plugin_count);
 void clean_plugins(plugin_handle_t* plugins, int plugin_count);
 void cleanup_temp_plugin_files();
@@ -46,6 +233,24 @@ void print_invalid_input(void);
 
 int main(int argc, char** argv) {
     atexit(cleanup_temp_plugin_files);
+
+    analyzer_options_t options;
+    int first_arg = parse_options(argc, argv, &options);
+
+    // Client of a running daemon - no pipeline of our own
+    if (options.connect_path) {
+        if (first_arg != argc || options.input_count > 0 || options.daemon_path) {
+            print_invalid_input();
+            exit(1);
+        }
+        int rc = daemon_client_run(options.connect_path, STDIN_FILENO);
+        free(options.inputs);
+        exit(rc == 0 ? 0 : 1);
+    }
+
+    // Re-base so argv[1] is <queue_size> again, as if no options were given
+    argc -= first_arg - 1;
+    argv += first_arg - 1;
     if (check_valid_args(argc, argv) == 0) {
         print_invalid_input();
         exit(1);
@@ -55,14 +260,131 @@ int main(int argc, char** argv) {
     int plugin_count = argc - 2;
     char** plugin_names = &argv[2];
 
+    // SIGHUP is only ever taken by the reload thread, SIGUSR1 by the stats
+    // reporter - block them before any thread exists
+    sigset_t taken;
+    sigemptyset(&taken);
+    sigaddset(&taken, SIGUSR1);
+    if (options.hot_swap) {
+        sigaddset(&taken, SIGHUP);
+    }
+    pthread_sigmask(SIG_BLOCK, &taken, NULL);
+
+    // A daemon reads its clients instead of an input; it binds before any thread exists
+    static daemon_server_t server;
+    if (options.daemon_path && options.input_count > 0) {
+        print_invalid_input();
+        exit(1);
+    }
+    if (options.daemon_path && daemon_server_open(&server, options.daemon_path) != 0) {
+        fprintf(stderr, "[ERROR] Cannot serve on '%s'\n", options.daemon_path);
+        exit(1);
+    }
+
+    // One input is read right here; several go through reader threads
+    input_source_t source;
+    const char* input_path = options.input_count == 1 ? options.inputs[0] : NULL;
+    if (!options.daemon_path && options.input_count <= 1 &&
+        input_source_open(&source, input_path, options.framing) != 0) {
+        fprintf(stderr, "[ERROR] Cannot open input '%s'\n", input_path ? input_path : "stdin");
+        exit(1);
+    }
+    for (int i = 0; options.input_count > 1 && i < options.input_count; ++i) {
+        const char* path = options.inputs[i];
+        if (strcmp(path, "-") != 0 && strncmp(path, "fd:", 3) != 0 && access(path, R_OK) != 0) {
+            fprintf(stderr, "[ERROR] Cannot open input '%s'\n", path);
+            exit(1);
+        }
+    }
+
+    if (options.sink_target && output_sink_open(&sink, options.sink_target, &options.sink_flush) != 0) {
+        fprintf(stderr, "[ERROR] Cannot open sink '%s'\n", options.sink_target);
+        exit(1);
+    }
+
+    startup_timings_t timings;
+    struct timespec phase_start;
+    clock_gettime(CLOCK_MONOTONIC, &phase_start);
     plugin_handle_t* plugin_handlers = create_plugins_handle(plugin_names, plugin_count, queue_size);
+    timings.load_ms = elapsed_ms(&phase_start);
+
+    clock_gettime(CLOCK_MONOTONIC, &phase_start);
     init_all_plugins(plugin_handlers, plugin_count, queue_size);
-    attach_all_plugins(plugin_handlers, plugin_count);
-    iterate_input_over_plugins(&plugin_handlers[0]);
+    timings.init_ms = elapsed_ms(&phase_start);
+
+    clock_gettime(CLOCK_MONOTONIC, &phase_start);
+    attach_all_plugins(plugin_handlers, plugin_count, options.sink_target ? sink_place_work : NULL);
+    timings.attach_ms = elapsed_ms(&phase_start);
+    if (options.timings) {
+        print_startup_timings(plugin_handlers, plugin_count, &timings);
+    }
+    static hot_swap_t swap;
+    if (options.hot_swap) {
+        hot_swap_start(&swap, plugin_handlers, plugin_count, queue_size);
+    }
+    if (options.trace_path && trace_start(options.trace_sample) != 0) {
+        exit(1);
+    }
+    static stats_reporter_t reporter;
+    stats_reporter_start(&reporter, plugin_handlers, plugin_count);
+    static occupancy_sampler_t sampler;
+    if (options.bottleneck) {
+        occupancy_sampler_start(&sampler, plugin_handlers, plugin_count);
+    }
+    static metrics_source_t metrics_source;
+    static metrics_exporter_t metrics;
+    if (options.metrics_target) {
+        metrics_source = (metrics_source_t){ plugin_handlers, plugin_count, stage_stats_now_ns() };
+        if (metrics_exporter_open(&metrics, options.metrics_target, options.metrics_interval_ms,
+                                  render_metrics, &metrics_source) != 0) {
+            fprintf(stderr, "[ERROR] Cannot export metrics to '%s'\n", options.metrics_target);
+            exit(1);
+        }
+    }
+    line_batch_t batch = { .first_plugin = &plugin_handlers[0], .chunk_lines = options.chunk_lines };
+    pthread_mutex_init(&batch.mutex, NULL);
+    // An input that fails part way still drains what it delivered, then exits non-zero
+    int input_failed = 0;
+    if (options.daemon_path) {
+        serve_clients_over_plugins(&batch, &server, options.framing);
+        daemon_server_close(&server);
+    } else if (options.input_count > 1) {
+        input_failed = iterate_inputs_over_plugins(&batch, &options) != 0;
+    } else {
+        input_failed = iterate_input_over_plugins(&batch, &source, options.readahead_lines) != 0;
+        input_source_close(&source);
+    }
+    chunk_builder_destroy(&batch.builder);
+    pthread_mutex_destroy(&batch.mutex);
     wait_for_all_plugins_to_finish(plugin_handlers, plugin_count);
+    if (options.hot_swap) {
+        hot_swap_stop(&swap);
+    }
+    stats_reporter_stop(&reporter);
+    if (options.bottleneck) {
+        occupancy_sampler_stop(&sampler);
+        print_bottleneck_report(&sampler);
+    }
+    if (options.metrics_target && metrics_exporter_close(&metrics) != 0) {
+        fprintf(stderr, "[ERROR] Failed to write the final metrics to '%s'\n", options.metrics_target);
+    }
+    if (options.stats) {
+        print_stage_stats(plugin_handlers, plugin_count);
+    }
+    if (options.latency) {
+        print_stage_latency(plugin_handlers, plugin_count);
+    }
+    if (options.trace_path && trace_write(options.trace_path) != 0) {
+        fprintf(stderr, "[ERROR] Failed to write trace '%s'\n", options.trace_path);
+    }
+    if (options.sink_target && output_sink_close(&sink) != 0) {
+        fprintf(stderr, "[ERROR] Failed to write all results to sink '%s'\n", options.sink_target);
+    }
+    chunk_view_destroy(&sink_chunk);
     clean_plugins(plugin_handlers, plugin_count);
+    free(options.inputs);
     printf("Pipeline shutdown complete\n");
-    return 0;
+    return input_failed ? 1 : 0;
 }
 
 
@@ -70,6 +392,154 @@ int main(int argc, char** argv) {
 
 
 
+// Parse the leading --options; returns the index of <queue_size> in argv
+// Stops at the first non-option, so plugin names are never taken as options
+int parse_options(int argc, char** argv, analyzer_options_t* options) {
+    static const struct option long_options[] = {
+        {"input", required_argument, NULL, 'i'},
+        {"io-engine", required_argument, NULL, OPT_IO_ENGINE},
+        {"framing", required_argument, NULL, OPT_FRAMING},
+        {"sink", required_argument, NULL, OPT_SINK},
+        {"sink-flush", required_argument, NULL, OPT_SINK_FLUSH},
+        {"readers", required_argument, NULL, OPT_READERS},
+        {"ordered", no_argument, NULL, OPT_ORDERED},
+        {"chunk-lines", required_argument, NULL, OPT_CHUNK_LINES},
+        {"readahead", required_argument, NULL, OPT_READAHEAD},
+        {"timings", no_argument, NULL, OPT_TIMINGS},
+        {"daemon", required_argument, NULL, OPT_DAEMON},
+        {"connect", required_argument, NULL, OPT_CONNECT},
+        {"hot-swap", no_argument, NULL, OPT_HOT_SWAP},
+        {"stats", no_argument, NULL, OPT_STATS},
+        {"latency", no_argument, NULL, OPT_LATENCY},
+        {"trace", required_argument, NULL, OPT_TRACE},
+        {"trace-sample", required_argument, NULL, OPT_TRACE_SAMPLE},
+        {"bottleneck", no_argument, NULL, OPT_BOTTLENECK},
+        {"metrics", required_argument, NULL, OPT_METRICS},
+        {"metrics-interval", required_argument, NULL, OPT_METRICS_INTERVAL},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    memset(options, 0, sizeof(*options));
+    options->sink_flush.bytes = OUTPUT_SINK_DEFAULT_FLUSH_BYTES;
+    options->sink_flush.interval_ms = OUTPUT_SINK_DEFAULT_FLUSH_MS;
+    options->group.readers = INPUT_GROUP_DEFAULT_READERS;
+    options->chunk_lines = 1;
+    options->readahead_lines = READAHEAD_DEFAULT_LINES;
+    options->trace_sample = TRACE_DEFAULT_SAMPLE;
+    options->metrics_interval_ms = METRICS_EXPORTER_DEFAULT_INTERVAL_MS;
+    options->inputs = calloc((size_t)argc, sizeof(*options->inputs)); // never more inputs than arguments
+    if (!options->inputs) {
+        fprintf(stderr, "[ERROR] Failed to allocate options.\n");
+        exit(1);
+    }
+    opterr = 0; // we print our own usage message
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "+i:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'i':
+            options->inputs[options->input_count++] = optarg;
+            break;
+        case OPT_IO_ENGINE:
+            if (strcmp(optarg, "sync") != 0 && strcmp(optarg, "uring") != 0) {
+                print_invalid_input();
+                exit(1);
+            }
+            // Plugins read the engine from the environment in plugin_init
+            setenv(IO_ENGINE_ENV, optarg, 1);
+            break;
+        case OPT_FRAMING:
+            if (framing_from_name(optarg, &options->framing) != 0) {
+                print_invalid_input();
+                exit(1);
+            }
+            break;
+        case OPT_READERS:
+            if (!is_arg_starts_with_number(optarg)) {
+                print_invalid_input();
+                exit(1);
+            }
+            options->group.readers = atoi(optarg);
+            break;
+        case OPT_ORDERED:
+            options->group.ordered = 1;
+            break;
+        case OPT_CHUNK_LINES:
+            if (!is_arg_starts_with_number(optarg)) {
+                print_invalid_input();
+                exit(1);
+            }
+            options->chunk_lines = atoi(optarg);
+            break;
+        case OPT_READAHEAD:
+            if (strcmp(optarg, "0") != 0 && !is_arg_starts_with_number(optarg)) {
+                print_invalid_input();
+                exit(1);
+            }
+            options->readahead_lines = atoi(optarg);
+            break;
+        case OPT_TIMINGS:
+            options->timings = 1;
+            break;
+        case OPT_DAEMON:
+            options->daemon_path = optarg;
+            break;
+        case OPT_CONNECT:
+            options->connect_path = optarg;
+            break;
+        case OPT_HOT_SWAP:
+            options->hot_swap = 1;
+            break;
+        case OPT_STATS:
+            options->stats = 1;
+            break;
+        case OPT_LATENCY:
+            options->latency = 1;
+            break;
+        case OPT_BOTTLENECK:
+            options->bottleneck = 1;
+            break;
+        case OPT_METRICS:
+            options->metrics_target = optarg;
+            break;
+        case OPT_METRICS_INTERVAL:
+            if (!is_arg_starts_with_number(optarg)) {
+                print_invalid_input();
+                exit(1);
+            }
+            options->metrics_interval_ms = atol(optarg);
+            break;
+        case OPT_TRACE:
+            options->trace_path = optarg;
+            break;
+        case OPT_TRACE_SAMPLE:
+            if (!is_arg_starts_with_number(optarg)) {
+                print_invalid_input();
+                exit(1);
+            }
+            options->trace_sample = atoi(optarg);
+            break;
+        case OPT_SINK:
+            options->sink_target = optarg;
+            break;
+        case OPT_SINK_FLUSH:
+            if (output_sink_parse_flush(optarg, &options->sink_flush) != 0) {
+                print_invalid_input();
+                exit(1);
+            }
+            break;
+        case 'h':
+            print_usage();
+            exit(0);
+        default:
+            print_invalid_input();
+            exit(1);
+        }
+    }
+    return optind;
+}
+
 int check_valid_args(int argc, char** argv) {
     if (argc < 3) {
         return 0;
@@ -100,13 +570,56 @@ int is_arg_starts_with_number(const char* str) {
 
 void print_invalid_input(void) {
     fprintf(stderr, "Invalid input.\n");
+    print_usage();
+}
 
-    printf("Usage: ./analyzer <queue_size> <plugin1> <plugin2> ... <pluginN>\n\n");
+void print_usage(void) {
+    printf("Usage: ./analyzer [options] <queue_size> <plugin1> <plugin2> ... <pluginN>\n");
+    printf("       ./analyzer --connect <socket> < input\n\n");
 
     printf("Arguments:\n");
     printf("  queue_size   Maximum number of items in each plugin's queue\n");
     printf("  plugin1..N   Names of plugins to load (without .so extension)\n\n");
 
+    printf("Options:\n");
+    printf("  -i, --input <file>   Read lines from <file> instead of stdin (regular files are memory mapped);\n");
+    printf("                       repeat to read several inputs concurrently (paths, - or fd:<n>)\n");
+    printf("  --readers <n>        Reader threads for several inputs (default %d)\n", INPUT_GROUP_DEFAULT_READERS);
+    printf("  --ordered            Feed several inputs one after another, in command line order\n");
+    printf("  --io-engine <name>   sync (default) or uring: batched io_uring reads and logger writes,\n");
+    printf("                       falls back to read/write where io_uring is unavailable\n");
+    printf("  --framing <mode>     lines (default), u32 (4 byte big-endian length + payload) or\n");
+    printf("                       varint (LEB128 length + payload); framed input ends at end of stream\n");
+    printf("  --chunk-lines <n>    Pack <n> lines into each queue message (default 1, no packing);\n");
+    printf("                       stages transform them one by one and pass the chunk on whole\n");
+    printf("  --readahead <n>      Lines read and split ahead of the first stage on a reader thread\n");
+    printf("                       (default %d, 0 reads in the main thread); memory mapped files skip it\n",
+           READAHEAD_DEFAULT_LINES);
+    printf("  --timings            Print per stage load and init times to stderr at startup\n");
+    printf("  --daemon <socket>    Keep the pipeline running and feed it every client stream sent to the\n");
+    printf("                       Unix socket (each ends at end of stream or <END>); SIGINT/SIGTERM stop it\n");
+    printf("  --connect <socket>   Send stdin to a daemon as one client stream and print its answer\n");
+    printf("  --hot-swap           On SIGHUP, stages whose " ANALYZER_PLUGIN_DIR "/<name>.so changed switch to the new build\n");
+    printf("                       (queued items wait, nothing is dropped); typewriter, and logger with\n");
+    printf("                       --io-engine uring, keep their build, their output is buffered outside the stage\n");
+    printf("  --stats              Print per stage throughput and wait times to stderr at shutdown\n");
+    printf("                       (SIGUSR1 prints them, and the latencies, at any time)\n");
+    printf("  --latency            Print per stage queueing, service and end-to-end latency percentiles\n");
+    printf("                       to stderr at shutdown\n");
+    printf("  --bottleneck         Sample every stage's queue fill while running and report at shutdown\n");
+    printf("                       which stage held the pipeline back, and for how long\n");
+    printf("  --metrics <target>   Publish stage counters, queue depths, latency histograms and allocator\n");
+    printf("                       stats in Prometheus text format: http:<port> serves them on 127.0.0.1,\n");
+    printf("                       file:<path> rewrites <path> every --metrics-interval ms (default %d)\n",
+           METRICS_EXPORTER_DEFAULT_INTERVAL_MS);
+    printf("  --trace <file>       Write the queue and processing spans of sampled messages in every stage\n");
+    printf("                       to <file> at shutdown, as Chrome trace JSON (chrome://tracing, Perfetto)\n");
+    printf("  --trace-sample <n>   Trace one message (line or chunk) in <n> (default %d)\n", TRACE_DEFAULT_SAMPLE);
+    printf("  --sink <target>      Write the last stage's results to stdout, file:<path> or fd:<n>\n");
+    printf("  --sink-flush <when>  every, end, or bytes:<N>,ms:<N> (default bytes:%d,ms:%d)\n",
+           OUTPUT_SINK_DEFAULT_FLUSH_BYTES, OUTPUT_SINK_DEFAULT_FLUSH_MS);
+    printf("  -h, --help           Print this help and exit\n\n");
+
     printf("Available plugins:\n");
     printf("  logger     - Logs all strings that pass through\n");
     printf("  typewriter - Simulates typewriter effect with delays\n");
@@ -121,159 +634,428 @@ void print_invalid_input(void) {
 
 
 //Creating the plugin handles
-plugin_handle_t* create_plugins_handle(char** plugin_names, int plugin_count, int queue_size) {
-    plugin_handle_t* plugins = calloc(plugin_count, sizeof(plugin_handle_t));
-    if (!plugins) {
-        fprintf(stderr, "[ERROR] Failed to allocate plugin handles.\n");
-        exit(1);
-    }
+// Run job(ctx, i) for every stage index, on up to STARTUP_THREADS threads
+// (the calling thread is one of them, so this works even if none can be created)
+typedef void (*stage_job_t)(void* ctx, int index);
 
-    for (int i = 0; i < plugin_count; ++i) {
-        // Count how many times this plugin has already appeared (before this point)
-        int instance_num = 1;
-        for (int j = 0; j < i; ++j) {
-            if (strcmp(plugin_names[i], plugin_names[j]) == 0) {
-                instance_num++;
-            }
-        }
 
-        char original_filename[256];
-        char actual_filename[256];
-        snprintf(original_filename, sizeof(original_filename), "output/%s.so", plugin_names[i]);
+typedef struct {
+    stage_job_t job;
+    void* ctx;
+    int count;
+    int next; // Next index to hand out
+} stage_jobs_t;
+
+static void* stage_worker(void* arg) {
+    stage_jobs_t* jobs = arg;
+    int index;
+    while ((index = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED)) < jobs->count) {
+        jobs->job(jobs->ctx, index);
+    }
+    return NULL;
+}
 
-        if (instance_num == 1) {
-            strcpy(actual_filename, original_filename);
-        } else {
-            snprintf(actual_filename, sizeof(actual_filename), "output/%s_temp_%d_%d.so",
-                     plugin_names[i], getpid(), instance_num);
-
-            FILE* src = fopen(original_filename, "rb");
-            FILE* dst = fopen(actual_filename, "wb");
-
-            if (!src || !dst) {
-                fprintf(stderr, "[ERROR] Failed to create temporary plugin copy\n");
-                if (src) fclose(src);
-                if (dst) fclose(dst);
-                for (int j = 0; j < i; ++j) {
-                    if (plugins[j].handle) dlclose(plugins[j].handle);
-                }
-                free(plugins);
-                exit(1);
-            }
+void run_stage_jobs(stage_job_t job, void* ctx, int count) {
+    stage_jobs_t jobs = { .job = job, .ctx = ctx, .count = count, .next = 0 };
+    pthread_t threads[STARTUP_THREADS];
+    int started = 0;
+    while (started < STARTUP_THREADS - 1 && started < count - 1 &&
+           pthread_create(&threads[started], NULL, stage_worker, &jobs) == 0) {
+        started++;
+    }
+    stage_worker(&jobs);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+}
 
-            char buffer[4096];
-            size_t bytes;
-            while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-                fwrite(buffer, 1, bytes, dst);
-            }
+double elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) * 1000.0 + (double)(now.tv_nsec - since->tv_nsec) / 1e6;
+}
 
-            fclose(src);
-            fclose(dst);
+typedef struct {
+    plugin_handle_t* plugins;
+    char** names;
+    int count;
+    char (*errors)[512]; // One message per stage, empty when it loaded
+} load_job_t;
+
+// Resolve one stage: built in, or dlopen of output/<name>.so (a private copy for repeats)
+static void load_stage(void* ctx, int i) {
+    load_job_t* load = ctx;
+    plugin_handle_t* plugin = &load->plugins[i];
+    const char* name = load->names[i];
+    char* error = load->errors[i];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    plugin->name = load->names[i];
+
+    // Count how many times this plugin has already appeared (before this point)
+    int instance_num = 1;
+    for (int j = 0; j < i; ++j) {
+        if (strcmp(name, load->names[j]) == 0) {
+            instance_num++;
         }
+    }
 
-        void* handle = dlopen(actual_filename, RTLD_NOW | RTLD_LOCAL);
-        if (!handle) {
-            fprintf(stderr, "[ERROR] dlopen failed for %s: %s\n", actual_filename, dlerror());
-            for (int j = 0; j < i; ++j) {
-                if (plugins[j].handle) dlclose(plugins[j].handle);
-            }
-            free(plugins);
-            exit(1);
+    // Built-in plugins skip dlopen; each has one set of state, so repeats still load the .so
+    char original_filename[256];
+    char actual_filename[256];
+    snprintf(original_filename, sizeof(original_filename), ANALYZER_PLUGIN_DIR "/%s.so", name);
+    if (stat(original_filename, &plugin->so_stat) != 0) {
+        memset(&plugin->so_stat, 0, sizeof(plugin->so_stat));
+    }
+
+    const static_plugin_t* builtin = static_plugin_find(name);
+    if (builtin && instance_num == 1) {
+        plugin->builtin = 1;
+        plugin->swap_transform = builtin->swap_transform;
+        plugin->get_stats = builtin->get_stats;
+        plugin->get_latency = builtin->get_latency;
+        plugin->get_queue_depth = builtin->get_queue_depth;
+        plugin->init = builtin->init;
+        plugin->fini = builtin->fini;
+        plugin->place_work = builtin->place_work;
+        plugin->place_work_n = builtin->place_work_n;
+        plugin->attach = builtin->attach;
+        plugin->wait_finished = builtin->wait_finished;
+        plugin->load_ms = elapsed_ms(&start);
+        return;
+    }
+    if (builtin) {
+        instance_num--; // the first instance is built in, so this one can use the .so itself
+    }
+
+    if (instance_num == 1) {
+        strcpy(actual_filename, original_filename);
+    } else {
+        snprintf(actual_filename, sizeof(actual_filename), ANALYZER_PLUGIN_DIR "/%s_temp_%d_%d.so",
+                 name, getpid(), instance_num);
+        if (copy_file(original_filename, actual_filename) != 0) {
+            snprintf(error, 512, "Failed to create temporary plugin copy");
+            return;
         }
+    }
 
-        plugin_handle_t* plugin = &plugins[i];
-        plugin->handle = handle;
-        plugin->name = plugin_names[i];
-        plugin->init = dlsym(handle, "plugin_init");
-        plugin->fini = dlsym(handle, "plugin_fini");
-        plugin->place_work = dlsym(handle, "plugin_place_work");
-        plugin->attach = dlsym(handle, "plugin_attach");
-        plugin->wait_finished = dlsym(handle, "plugin_wait_finished");
-
-        if (!plugin->init || !plugin->fini || !plugin->place_work ||
-            !plugin->attach || !plugin->wait_finished) {
-            fprintf(stderr, "[ERROR] dlsym error in %s: %s\n", plugin_names[i], dlerror());
-            for (int j = 0; j <= i; ++j) {
-                if (plugins[j].handle) dlclose(plugins[j].handle);
-            }
-            free(plugins);
-            exit(1);
+    void* handle = dlopen(actual_filename, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        snprintf(error, 512, "dlopen failed for %s: %s", actual_filename, dlerror());
+        return;
+    }
+
+    plugin->handle = handle;
+    plugin->init = dlsym(handle, "plugin_init");
+    plugin->fini = dlsym(handle, "plugin_fini");
+    plugin->place_work = dlsym(handle, "plugin_place_work");
+    plugin->attach = dlsym(handle, "plugin_attach");
+    plugin->wait_finished = dlsym(handle, "plugin_wait_finished");
+    plugin->place_work_n = dlsym(handle, "plugin_place_work_n");
+    plugin->swap_transform = dlsym(handle, "plugin_swap_transform");
+    plugin->get_stats = dlsym(handle, "plugin_get_stats");
+    plugin->get_latency = dlsym(handle, "plugin_get_latency");
+    plugin->get_queue_depth = dlsym(handle, "plugin_get_queue_depth");
+
+    if (!plugin->init || !plugin->fini || !plugin->place_work ||
+        !plugin->attach || !plugin->wait_finished) {
+        snprintf(error, 512, "dlsym error in %s: %s", name, dlerror());
+    }
+    plugin->load_ms = elapsed_ms(&start);
+}
+
+// Stages are loaded in parallel (dlopen, relocation and the copies for repeated
+// plugins overlap); errors are reported in stage order once all are done
+plugin_handle_t* create_plugins_handle(char** plugin_names, int plugin_count, int queue_size) {
+    (void)queue_size;
+    plugin_handle_t* plugins = calloc(plugin_count, sizeof(plugin_handle_t));
+    char (*errors)[512] = calloc(plugin_count, sizeof(*errors));
+    if (!plugins || !errors) {
+        fprintf(stderr, "[ERROR] Failed to allocate plugin handles.\n");
+        exit(1);
+    }
+
+    load_job_t load = { .plugins = plugins, .names = plugin_names, .count = plugin_count, .errors = errors };
+    run_stage_jobs(load_stage, &load, plugin_count);
+
+    for (int i = 0; i < plugin_count; ++i) {
+        if (errors[i][0] == '\0') {
+            continue;
         }
+        fprintf(stderr, "[ERROR] %s\n", errors[i]);
+        for (int j = 0; j < plugin_count; ++j) {
+            if (plugins[j].handle) dlclose(plugins[j].handle);
+        }
+        free(errors);
+        free(plugins);
+        exit(1);
     }
 
+    free(errors);
     return plugins;
 }
 
+typedef struct {
+    plugin_handle_t* plugins;
+    int queue_size;
+    const char** errors; // Per stage, NULL when it initialized
+} init_job_t;
+
+static void init_stage(void* ctx, int i) {
+    init_job_t* init = ctx;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    init->errors[i] = init->plugins[i].init(init->queue_size);
+    init->plugins[i].init_ms = elapsed_ms(&start);
+}
 
-// After creating plugin handles, we need to init each
+// Plugins are independent until attached, so they initialize in parallel
 void init_all_plugins(plugin_handle_t* plugins, int plugin_count, int queue_size) {
+    const char** errors = calloc(plugin_count, sizeof(*errors));
+    if (!errors) {
+        fprintf(stderr, "[ERROR] Failed to allocate plugin handles.\n");
+        exit(1);
+    }
+
+    init_job_t init = { .plugins = plugins, .queue_size = queue_size, .errors = errors };
+    run_stage_jobs(init_stage, &init, plugin_count);
+
+    int failed = 0;
     for (int i = 0; i < plugin_count; ++i) {
-        const char* init_error = plugins[i].init(queue_size);
-        if (init_error != NULL) {
+        if (errors[i] != NULL) {
             fprintf(stderr, "[ERROR] Initialization failed for plugin '%s': %s\n",
-                    plugins[i].name, init_error);
-
-            // Clean up previously initialized plugins
-            for (int j = 0; j <= i; ++j) {
-                if (plugins[j].fini) {
-                    plugins[j].fini();
-                }
-                if (plugins[j].handle) {
-                    dlclose(plugins[j].handle);
-                }
-            }
+                    plugins[i].name, errors[i]);
+            failed = 1;
+        }
+    }
 
-            free(plugins);
-            exit(1);
+    if (failed) {
+        // Clean up the plugins that did initialize
+        for (int j = 0; j < plugin_count; ++j) {
+            if (errors[j] == NULL) {
+                plugins[j].fini();
+            }
+            if (plugins[j].handle) {
+                dlclose(plugins[j].handle);
+            }
         }
+
+        free(errors);
+        free(plugins);
+        exit(1);
     }
+    free(errors);
 }
 
-// After all plugins are initialized, we can attach them to each other
-void attach_all_plugins(plugin_handle_t* plugins, int plugin_count) {
+// --timings: where startup went, per stage
+void print_startup_timings(const plugin_handle_t* plugins, int plugin_count, const startup_timings_t* timings) {
+    fprintf(stderr, "Startup timings (ms):\n");
+    fprintf(stderr, "  %-5s %-16s %-8s %10s %10s\n", "stage", "plugin", "source", "load", "init");
+    for (int i = 0; i < plugin_count; ++i) {
+        fprintf(stderr, "  %-5d %-16s %-8s %10.3f %10.3f\n", i + 1, plugins[i].name,
+                plugins[i].builtin ? "built-in" : "dlopen", plugins[i].load_ms, plugins[i].init_ms);
+    }
+    fprintf(stderr, "  load %.3f, init %.3f, attach %.3f, total %.3f (%d stages, up to %d threads)\n",
+            timings->load_ms, timings->init_ms, timings->attach_ms,
+            timings->load_ms + timings->init_ms + timings->attach_ms, plugin_count, STARTUP_THREADS);
+}
+void attach_all_plugins(plugin_handle_t* plugins, int plugin_count, const char* (*last_next)(const char*)) {
     for (int i = 0; i < plugin_count; ++i) {
         if (i < plugin_count - 1) {
             plugins[i].attach(plugins[i + 1].place_work);
         } else {
-            // Attach NULL to last plugin 
-            plugins[i].attach(NULL);
+            // Last plugin feeds the sink, or NULL when there is none
+            plugins[i].attach(last_next);
         }
     }
 }
 
+// Runs on the last plugin's consumer thread for each result
+const char* sink_place_work(const char* str) {
+    if (str == NULL) {
+        return "sink_place_work received NULL";
+    }
+    if (strcmp(str, "<END>") == 0) {
+        return NULL; // end of stream, not a result
+    }
+    size_t len = strlen(str);
+    // Runs on the last stage's thread, which flagged the result if it is a chunk
+    if ((consumer_producer_thread_flags() & QUEUE_ITEM_CHUNK) && chunk_parse(str, len, &sink_chunk) == 0) {
+        for (int i = 0; i < sink_chunk.count; ++i) {
+            if (output_sink_write(&sink, str + sink_chunk.offsets[i], sink_chunk.lengths[i]) != 0) {
+                return "Output sink write failed";
+            }
+        }
+        return NULL;
+    }
+    if (output_sink_write(&sink, str, len) != 0) {
+        return "Output sink write failed";
+    }
+    return NULL;
+}
 
-//Now when we have the "list", we can iterate it
-#define MAX_LINE_LEN 1025 // 1024 +1 for fgets 
-void iterate_input_over_plugins(plugin_handle_t* first_plugin) {
-    char buffer[MAX_LINE_LEN];
 
-    while (fgets(buffer, sizeof(buffer), stdin)) {
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') {
-            buffer[len - 1] = '\0';
-        }
+//Now when we have the "list", we can iterate it
+// Streams are read on a reader thread, so input keeps coming in while the first stage's
+// queue is full; mapped files are already in memory and are split right here
+// Returns -1 if the input could not be read to its end
+int iterate_input_over_plugins(line_batch_t* batch, input_source_t* source, int readahead_lines) {
+    readahead_t ahead;
+    size_t lines = source->kind == INPUT_SOURCE_STREAM ? (size_t)readahead_lines : 0;
+    if (readahead_start(&ahead, source, lines) != 0 && readahead_start(&ahead, source, 0) != 0) {
+        exit(1);
+    }
 
-        // Duplicate the string to send to plugin (plugin frees it at the end)
-        char* input_copy = strdup(buffer);
-        if (!input_copy) {
-            fprintf(stderr, "[ERROR] Memory allocation failed for input.\n");
+    const char* line;
+    size_t len;
+    int rc;
+    // Stops at end of input or at anything that reads as "<END>" up to its first '\0' -
+    // framed input could go on, but reading on would fill queues nobody drains
+    while ((rc = readahead_next(&ahead, &line, &len)) > 0) {
+        // Send to first plugin - its queue makes the one copy the stage owns
+        if (deliver_line(batch, line, len) != 0) {
             exit(1);
         }
+    }
+    readahead_stop(&ahead);
 
-        // Send to first plugin
-        const char* error = first_plugin->place_work(input_copy);
-        if (error != NULL) {
-            fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
-            free(input_copy);
-            exit(1);
-        }
+    if (rc < 0) {
+        fprintf(stderr, "[ERROR] Failed to read input from %s.\n", source->name);
+    }
 
-        if (strcmp(buffer, "<END>") == 0) {
-            break;
+    // Lines still waiting for a full chunk go out before the end marker
+    const char* error = flush_batch(batch);
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+        exit(1);
+    }
+
+    // Same <END> whether the input had one or just ended
+    place_end(batch->first_plugin);
+    return rc < 0 ? -1 : 0;
+}
+
+// Several inputs: reader threads place lines straight into the first plugin's queue
+// (it is thread safe); the pipeline gets one <END> once every input is done
+// Returns -1 if any input could not be read to its end
+int iterate_inputs_over_plugins(line_batch_t* batch, const analyzer_options_t* options) {
+    input_group_options_t group = options->group;
+    group.framing = options->framing;
+
+    int rc = input_group_run(options->inputs, options->input_count, &group, deliver_line, batch);
+
+    const char* error = flush_batch(batch);
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+        rc = -1;
+    }
+    place_end(batch->first_plugin);
+    return rc;
+}
+
+// Daemon: client threads place lines like reader threads do; the pipeline gets its
+// one <END> when the daemon is stopped
+void serve_clients_over_plugins(line_batch_t* batch, daemon_server_t* server, input_framing_t framing) {
+    if (daemon_server_run(server, framing, deliver_line, flush_shared_batch, batch) != 0) {
+        fprintf(stderr, "[ERROR] Daemon stopped accepting clients\n");
+    }
+
+    const char* error = flush_batch(batch);
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+    }
+    place_end(batch->first_plugin);
+}
+
+// Place one line, or add it to the current chunk and place the chunk once it is full
+int deliver_line(void* ctx, const char* line, size_t len) {
+    line_batch_t* batch = ctx;
+    const char* error = NULL;
+
+    if (batch->chunk_lines <= 1) {
+        // Ingest is now, as the line is read - waiting for room in stage 1 counts as latency
+        consumer_producer_set_thread_origin(stage_stats_now_ns(), trace_sample(), 0);
+        error = place_line(batch->first_plugin, line, len);
+        consumer_producer_set_thread_origin(0, 0, 0);
+    } else {
+        // Stages only ever see a line up to its first '\0'
+        size_t text_len = strnlen(line, len);
+        pthread_mutex_lock(&batch->mutex);
+        if (batch->builder.count == 0) {
+            batch->first_line_ns = stage_stats_now_ns();
+        }
+        if (chunk_builder_add(&batch->builder, line, text_len) != 0) {
+            error = "Memory allocation failed for input";
+        } else if (batch->builder.count >= batch->chunk_lines) {
+            error = flush_batch(batch);
         }
+        pthread_mutex_unlock(&batch->mutex);
+    }
+
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+        return -1;
+    }
+    return 0;
+}
+
+// flush_batch for callers that share the batch with other threads
+int flush_shared_batch(void* ctx) {
+    line_batch_t* batch = ctx;
+    pthread_mutex_lock(&batch->mutex);
+    const char* error = flush_batch(batch);
+    pthread_mutex_unlock(&batch->mutex);
+
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+        return -1;
+    }
+    return 0;
+}
+
+// Place the lines collected so far as one chunk (caller holds batch->mutex when threads share it)
+const char* flush_batch(line_batch_t* batch) {
+    if (batch->builder.count == 0) {
+        return NULL;
+    }
+
+    size_t len = 0;
+    char* chunk = chunk_builder_finish(&batch->builder, &len);
+    if (!chunk) {
+        return "Memory allocation failed for input";
+    }
+    // The chunk is as old as its first line, not as the moment it filled up
+    consumer_producer_set_thread_origin(batch->first_line_ns, trace_sample(), QUEUE_ITEM_CHUNK);
+    const char* error = place_line(batch->first_plugin, chunk, len);
+    consumer_producer_set_thread_origin(0, 0, 0);
+    free(chunk);
+    return error;
+}
+
+void place_end(plugin_handle_t* first_plugin) {
+    const char* error = first_plugin->place_work("<END>");
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Failed to place work in plugin: %s\n", error);
+        exit(1);
     }
 }
 
+// Hand one line to a plugin, skipping the strlen when the plugin takes a length
+const char* place_line(plugin_handle_t* plugin, const char* line, size_t len) {
+    if (plugin->place_work_n) {
+        return plugin->place_work_n(line, len);
+    }
+
+    // Older plugin - needs a terminated copy (mapped lines are not terminated)
+    char* copy = strndup(line, len);
+    if (!copy) {
+        return "Memory allocation failed for input";
+    }
+    const char* error = plugin->place_work(copy);
+    free(copy);
+    return error;
+}
+
 //Wait for all plugins to finish (we get here after an <END> call breakes the loop in the finction above)
 void wait_for_all_plugins_to_finish(plugin_handle_t* plugins, int plugin_count) {
     for (int i = 0; i < plugin_count; ++i) {
@@ -297,15 +1079,613 @@ void clean_plugins(plugin_handle_t* plugins, int plugin_count) {
         if (plugins[i].handle) {
             dlclose(plugins[i].handle);
         }
+
+        // The stage's thread is gone, so the swapped in build can go too
+        if (plugins[i].swap_handle) {
+            const char* error = plugins[i].swap_fini();
+            if (error != NULL) {
+                fprintf(stderr, "[ERROR] Plugin '%s' (reloaded) failed to clean up: %s\n", plugins[i].name, error);
+            }
+            dlclose(plugins[i].swap_handle);
+        }
     }
 
     free(plugins);  
 }
 
+// Copy a file (a private copy of a .so gets its own dlopen handle and static state)
+int copy_file(const char* from, const char* to) {
+    FILE* src = fopen(from, "rb");
+    FILE* dst = fopen(to, "wb");
+    if (!src || !dst) {
+        if (src) fclose(src);
+        if (dst) fclose(dst);
+        return -1;
+    }
+
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0) {
+        fwrite(buffer, 1, bytes, dst);
+    }
+
+    int failed = ferror(src) || ferror(dst);
+    fclose(src);
+    if (fclose(dst) != 0) {
+        failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+static int same_file_version(const struct stat* a, const struct stat* b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+// Load the current output/<name>.so next to the running stage and switch the stage's
+// transform over to it. The new build is initialized (so it reads its configuration
+// and sets up its own state) but its queue and thread stay unused - the stage keeps
+// its queue, its position in the chain and everything already queued
+static void reload_stage(hot_swap_t* swap, int index) {
+    plugin_handle_t* plugin = &swap->plugins[index];
+    char original_filename[256];
+    snprintf(original_filename, sizeof(original_filename), ANALYZER_PLUGIN_DIR "/%s.so", plugin->name);
+
+    struct stat st;
+    if (stat(original_filename, &st) != 0 || same_file_version(&st, &plugin->so_stat)) {
+        return;
+    }
+    if (!plugin->swap_transform) {
+        fprintf(stderr, "[ERROR] Plugin '%s' cannot be hot-swapped: it has no plugin_swap_transform\n", plugin->name);
+        return;
+    }
+
+    // dlopen hands back the already loaded library for a known path, so every build gets a new one
+    char copy_filename[256];
+    snprintf(copy_filename, sizeof(copy_filename), ANALYZER_PLUGIN_DIR "/%s_temp_%d_swap%d.so",
+             plugin->name, getpid(), ++swap->swaps);
+    if (copy_file(original_filename, copy_filename) != 0) {
+        fprintf(stderr, "[ERROR] Failed to create temporary plugin copy\n");
+        unlink(copy_filename);
+        return;
+    }
+    void* handle = dlopen(copy_filename, RTLD_NOW | RTLD_LOCAL);
+    unlink(copy_filename); // the mapping stays
+    if (!handle) {
+        fprintf(stderr, "[ERROR] Hot swap of '%s': dlopen failed: %s\n", plugin->name, dlerror());
+        return;
+    }
+
+    plugin_init_func_t init = dlsym(handle, "plugin_init");
+    plugin_fini_func_t fini = dlsym(handle, "plugin_fini");
+    plugin_transform_func_t transform = dlsym(handle, "plugin_transform");
+    if (!init || !fini || !transform) {
+        fprintf(stderr, "[ERROR] Hot swap of '%s': new build does not export plugin_transform\n", plugin->name);
+        dlclose(handle);
+        return;
+    }
+
+    const char* error = init(swap->queue_size);
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Hot swap of '%s': initialization failed: %s\n", plugin->name, error);
+        dlclose(handle);
+        return;
+    }
+
+    error = plugin->swap_transform(transform);
+    if (error != NULL) {
+        fprintf(stderr, "[ERROR] Hot swap of '%s' failed: %s\n", plugin->name, error);
+        fini();
+        dlclose(handle);
+        return;
+    }
+
+    // The previous reload is no longer called - the swap waited for its last item
+    if (plugin->swap_handle) {
+        plugin->swap_fini();
+        dlclose(plugin->swap_handle);
+    }
+    plugin->swap_handle = handle;
+    plugin->swap_fini = fini;
+    plugin->so_stat = st;
+    fprintf(stderr, "[INFO] Stage %d (%s) switched to the reloaded build\n", index + 1, plugin->name);
+}
+
+void reload_changed_plugins(hot_swap_t* swap) {
+    for (int i = 0; i < swap->plugin_count; ++i) {
+        reload_stage(swap, i);
+    }
+}
+
+static void* hot_swap_thread(void* arg) {
+    hot_swap_t* swap = arg;
+    sigset_t hangup;
+    sigemptyset(&hangup);
+    sigaddset(&hangup, SIGHUP);
+
+    while (1) {
+        int signal_number;
+        if (sigwait(&hangup, &signal_number) != 0) {
+            continue;
+        }
+        pthread_mutex_lock(&swap->mutex);
+        if (swap->stopping) {
+            pthread_mutex_unlock(&swap->mutex);
+            break;
+        }
+        reload_changed_plugins(swap);
+        pthread_mutex_unlock(&swap->mutex);
+    }
+    return NULL;
+}
+
+// Caller must have SIGHUP blocked in every thread (main blocks it before creating any)
+void hot_swap_start(hot_swap_t* swap, plugin_handle_t* plugins, int plugin_count, int queue_size) {
+    memset(swap, 0, sizeof(*swap));
+    swap->plugins = plugins;
+    swap->plugin_count = plugin_count;
+    swap->queue_size = queue_size;
+    pthread_mutex_init(&swap->mutex, NULL);
+
+    if (pthread_create(&swap->thread, NULL, hot_swap_thread, swap) != 0) {
+        fprintf(stderr, "[ERROR] Failed to start the hot swap thread - SIGHUP is ignored\n");
+        return;
+    }
+    swap->running = 1;
+}
+
+// No reload may run once the stages are being finalized
+void hot_swap_stop(hot_swap_t* swap) {
+    if (swap->running) {
+        pthread_mutex_lock(&swap->mutex);
+        swap->stopping = 1;
+        pthread_mutex_unlock(&swap->mutex);
+        pthread_kill(swap->thread, SIGHUP);
+        pthread_join(swap->thread, NULL);
+        swap->running = 0;
+    }
+    pthread_mutex_destroy(&swap->mutex);
+}
+
+// Stage counters as a table on stderr; a stage's "out wait" is the time it was
+// blocked on the next stage's full queue, "in wait" the time its own queue was empty
+void print_stage_stats(const plugin_handle_t* plugins, int plugin_count) {
+    stage_stats_t* stats = calloc(plugin_count, sizeof(*stats));
+    if (!stats) {
+        return;
+    }
+    for (int i = 0; i < plugin_count; ++i) {
+        if (!plugins[i].get_stats || plugins[i].get_stats(&stats[i]) != NULL) {
+            memset(&stats[i], 0, sizeof(stats[i]));
+        }
+    }
+
+    fprintf(stderr, "Stage stats:\n");
+    fprintf(stderr, "  %-5s %-16s %12s %14s %12s %14s %8s %12s %12s %12s\n", "stage", "plugin",
+            "items in", "bytes in", "items out", "bytes out", "errors", "process ms", "in wait ms", "out wait ms");
+    for (int i = 0; i < plugin_count; ++i) {
+        uint64_t out_wait_ns = i + 1 < plugin_count ? stats[i + 1].put_wait_ns : 0;
+        fprintf(stderr, "  %-5d %-16s %12llu %14llu %12llu %14llu %8llu %12.3f %12.3f %12.3f%s\n", i + 1, plugins[i].name,
+                (unsigned long long)stats[i].items_in, (unsigned long long)stats[i].bytes_in,
+                (unsigned long long)stats[i].items_out, (unsigned long long)stats[i].bytes_out,
+                (unsigned long long)stats[i].errors,
+                stats[i].process_ns / 1e6, stats[i].get_wait_ns / 1e6, out_wait_ns / 1e6,
+                plugins[i].get_stats ? "" : " (no counters)");
+    }
+    if (plugin_count > 0) {
+        fprintf(stderr, "  input blocked on stage 1 for %.3f ms\n", stats[0].put_wait_ns / 1e6);
+    }
+    free(stats);
+}
+
+// Latency percentiles on stderr, in microseconds; the last stage's "since ingest"
+// row is the pipeline's end-to-end latency
+void print_stage_latency(const plugin_handle_t* plugins, int plugin_count) {
+    stage_latency_t* latency = malloc(sizeof(*latency));
+    if (!latency) {
+        return;
+    }
+
+    static const double percentiles[] = { 50, 99, 99.9 };
+    fprintf(stderr, "Stage latency (us):\n");
+    fprintf(stderr, "  %-5s %-16s %-12s %12s %10s %10s %10s %10s\n", "stage", "plugin", "",
+            "items", "p50", "p99", "p99.9", "max");
+    for (int i = 0; i < plugin_count; ++i) {
+        if (!plugins[i].get_latency || plugins[i].get_latency(latency) != NULL) {
+            fprintf(stderr, "  %-5d %-16s (no histograms)\n", i + 1, plugins[i].name);
+            continue;
+        }
+        const struct { const char* label; const latency_histogram_t* histogram; } rows[] = {
+            { "queue", &latency->queue },
+            { "service", &latency->service },
+            { i + 1 < plugin_count ? "since ingest" : "end-to-end", &latency->since_ingest },
+        };
+        for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); ++r) {
+            const latency_histogram_t* histogram = rows[r].histogram;
+            fprintf(stderr, "  %-5d %-16s %-12s %12llu", i + 1, plugins[i].name, rows[r].label,
+                    (unsigned long long)histogram->total);
+            for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); ++p) {
+                fprintf(stderr, " %10.1f", latency_histogram_percentile(histogram, percentiles[p]) / 1e3);
+            }
+            fprintf(stderr, " %10.1f\n", histogram->max / 1e3);
+        }
+    }
+    free(latency);
+}
+
+static void* stats_reporter_thread(void* arg) {
+    stats_reporter_t* reporter = arg;
+    sigset_t user1;
+    sigemptyset(&user1);
+    sigaddset(&user1, SIGUSR1);
+
+    while (1) {
+        int signal_number;
+        if (sigwait(&user1, &signal_number) != 0) {
+            continue;
+        }
+        if (__atomic_load_n(&reporter->stopping, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        print_stage_stats(reporter->plugins, reporter->plugin_count);
+        print_stage_latency(reporter->plugins, reporter->plugin_count);
+    }
+    return NULL;
+}
+
+// Caller must have SIGUSR1 blocked in every thread (main blocks it before creating any)
+void stats_reporter_start(stats_reporter_t* reporter, plugin_handle_t* plugins, int plugin_count) {
+    memset(reporter, 0, sizeof(*reporter));
+    reporter->plugins = plugins;
+    reporter->plugin_count = plugin_count;
+
+    if (pthread_create(&reporter->thread, NULL, stats_reporter_thread, reporter) != 0) {
+        fprintf(stderr, "[ERROR] Failed to start the stats thread - SIGUSR1 is ignored\n");
+        return;
+    }
+    reporter->running = 1;
+}
+
+// The stages are finalized next, so no report may run after this
+void stats_reporter_stop(stats_reporter_t* reporter) {
+    if (reporter->running) {
+        __atomic_store_n(&reporter->stopping, 1, __ATOMIC_RELEASE);
+        pthread_kill(reporter->thread, SIGUSR1);
+        pthread_join(reporter->thread, NULL);
+        reporter->running = 0;
+    }
+}
+
+static void take_occupancy_sample(occupancy_sampler_t* sampler) {
+    int count = sampler->plugin_count;
+    for (int i = 0; i < count; ++i) {
+        int capacity = 0;
+        const plugin_handle_t* plugin = &sampler->plugins[i];
+        if (!plugin->get_queue_depth || plugin->get_queue_depth(&sampler->counts[i], &capacity) != NULL ||
+            sampler->counts[i] < 0) {
+            sampler->counts[i] = -1;
+            continue;
+        }
+        sampler->stages[i].capacity = capacity;
+    }
+
+    // A stage holds the pipeline back when work piles up before it while the
+    // stage after it starves; the last stage's output (the sink) never fills
+    for (int i = 0; i < count; ++i) {
+        stage_occupancy_t* stage = &sampler->stages[i];
+        int fill = sampler->counts[i];
+        if (fill < 0) {
+            continue;
+        }
+        int next = i + 1 < count ? sampler->counts[i + 1] : 0;
+        stage->fill_sum += (uint64_t)fill;
+        stage->full += (fill == stage->capacity);
+        stage->empty += (fill == 0);
+        stage->bottleneck += (fill == stage->capacity && next == 0);
+    }
+    sampler->samples++;
+}
+
+static void* occupancy_sampler_thread(void* arg) {
+    occupancy_sampler_t* sampler = arg;
+    const struct timespec period = { 0, OCCUPANCY_SAMPLE_MS * 1000000L };
+    while (!__atomic_load_n(&sampler->stopping, __ATOMIC_ACQUIRE)) {
+        take_occupancy_sample(sampler);
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+void occupancy_sampler_start(occupancy_sampler_t* sampler, plugin_handle_t* plugins, int plugin_count) {
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->plugins = plugins;
+    sampler->plugin_count = plugin_count;
+    sampler->stages = calloc(plugin_count, sizeof(*sampler->stages));
+    sampler->counts = calloc(plugin_count, sizeof(*sampler->counts));
+    sampler->start_ns = stage_stats_now_ns();
+    if (!sampler->stages || !sampler->counts ||
+        pthread_create(&sampler->thread, NULL, occupancy_sampler_thread, sampler) != 0) {
+        fprintf(stderr, "[ERROR] Failed to start the queue sampler - no bottleneck report\n");
+        return;
+    }
+    sampler->running = 1;
+}
+
+// Stops within one sampling period; the tallies stay for print_bottleneck_report
+void occupancy_sampler_stop(occupancy_sampler_t* sampler) {
+    if (sampler->running) {
+        __atomic_store_n(&sampler->stopping, 1, __ATOMIC_RELEASE);
+        pthread_join(sampler->thread, NULL);
+        sampler->running = 0;
+    }
+    sampler->end_ns = stage_stats_now_ns();
+}
+
+// Mean nanoseconds per item, 0 when nothing was counted
+static double per_item_ns(double total_ns, uint64_t items) {
+    return items > 0 && total_ns > 0 ? total_ns / (double)items : 0;
+}
+
+// Replicas of the bottleneck stage that would bring it up to the pace of the
+// next slowest part of the pipeline - another stage, or the input itself
+// Returns 0 when the stage counters needed for the estimate are missing
+static int suggest_replicas(const occupancy_sampler_t* sampler, int bottleneck, double* stage_ns, double* peer_ns) {
+    int count = sampler->plugin_count;
+    stage_stats_t* stats = calloc(count, sizeof(*stats));
+    if (!stats) {
+        return 0;
+    }
+    int known = 1;
+    for (int i = 0; i < count; ++i) {
+        const plugin_handle_t* plugin = &sampler->plugins[i];
+        if (!plugin->get_stats || plugin->get_stats(&stats[i]) != NULL) {
+            known = (i != bottleneck) && known;
+            memset(&stats[i], 0, sizeof(stats[i]));
+        }
+    }
+
+    *stage_ns = per_item_ns((double)stats[bottleneck].process_ns, stats[bottleneck].items_in);
+    // The input's own pace: wall time it was not blocked on the first stage
+    double wall_ns = (double)(sampler->end_ns - sampler->start_ns);
+    *peer_ns = per_item_ns(wall_ns - (double)stats[0].put_wait_ns, stats[0].items_in);
+    for (int i = 0; i < count; ++i) {
+        double ns = per_item_ns((double)stats[i].process_ns, stats[i].items_in);
+        if (i != bottleneck && ns > *peer_ns) {
+            *peer_ns = ns;
+        }
+    }
+    free(stats);
+
+    if (!known || *stage_ns <= 0 || *peer_ns <= 0) {
+        return 0;
+    }
+    double ratio = *stage_ns / *peer_ns;
+    if (ratio >= OCCUPANCY_MAX_REPLICAS) {
+        return OCCUPANCY_MAX_REPLICAS;
+    }
+    int replicas = (int)ratio + (ratio > (int)ratio); // Rounded up
+    return replicas < 1 ? 1 : replicas;
+}
+
+// Queue fill per stage, then the stage that most often had a full input queue
+// and an empty output queue, with its share of the run and a replica estimate
+void print_bottleneck_report(const occupancy_sampler_t* sampler) {
+    if (!sampler->stages || sampler->samples == 0) {
+        fprintf(stderr, "Queue occupancy: no samples\n");
+        return;
+    }
+
+    double samples = (double)sampler->samples;
+    fprintf(stderr, "Queue occupancy (%llu samples, every %d ms):\n",
+            (unsigned long long)sampler->samples, OCCUPANCY_SAMPLE_MS);
+    fprintf(stderr, "  %-5s %-16s %10s %10s %8s %8s %12s\n", "stage", "plugin",
+            "capacity", "avg fill", "full %", "empty %", "bottleneck %");
+    int worst = -1;
+    for (int i = 0; i < sampler->plugin_count; ++i) {
+        const stage_occupancy_t* stage = &sampler->stages[i];
+        if (!sampler->plugins[i].get_queue_depth) {
+            fprintf(stderr, "  %-5d %-16s (no queue depth)\n", i + 1, sampler->plugins[i].name);
+            continue;
+        }
+        fprintf(stderr, "  %-5d %-16s %10d %10.1f %8.1f %8.1f %12.1f\n", i + 1, sampler->plugins[i].name,
+                stage->capacity, stage->fill_sum / samples, 100.0 * stage->full / samples,
+                100.0 * stage->empty / samples, 100.0 * stage->bottleneck / samples);
+        if (stage->bottleneck > 0 && (worst < 0 || stage->bottleneck > sampler->stages[worst].bottleneck)) {
+            worst = i;
+        }
+    }
+
+    if (worst < 0) {
+        fprintf(stderr, "Bottleneck: none - no stage had a full input queue and an empty output queue\n"
+                        "  (the stages kept up with the input)\n");
+        return;
+    }
+    double stage_ns = 0;
+    double peer_ns = 0;
+    int replicas = suggest_replicas(sampler, worst, &stage_ns, &peer_ns);
+    fprintf(stderr, "Bottleneck: stage %d (%s), %.1f%% of wall time\n", worst + 1,
+            sampler->plugins[worst].name, 100.0 * sampler->stages[worst].bottleneck / samples);
+    if (replicas > 1) {
+        fprintf(stderr, "  suggested replicas: %d (%.1f us per item, next slowest %.1f us)\n",
+                replicas, stage_ns / 1e3, peer_ns / 1e3);
+    } else if (replicas == 1) {
+        // Its queue backed up although its transform is not slower - it was
+        // short of CPU time rather than of copies
+        fprintf(stderr, "  suggested replicas: 1 (%.1f us per item, next slowest %.1f us -"
+                        " check for CPU contention)\n", stage_ns / 1e3, peer_ns / 1e3);
+    } else {
+        fprintf(stderr, "  suggested replicas: unknown (no stage counters)\n");
+    }
+}
+
+// Latency histogram bounds for --metrics, in seconds (1-2.5-5 steps)
+static const double metrics_latency_bounds[] = {
+    1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4,
+    1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+};
+
+// Prometheus label values: backslash, double quote and newline are escaped
+static void write_label_value(FILE* out, const char* value) {
+    for (const char* c = value; *c != '\0'; ++c) {
+        if (*c == '\\' || *c == '"') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c == '\n') {
+            fputs("\\n", out);
+        } else {
+            fputc(*c, out);
+        }
+    }
+}
+
+static void write_stage_labels(FILE* out, int stage, const char* plugin) {
+    fprintf(out, "stage=\"%d\",plugin=\"", stage);
+    write_label_value(out, plugin);
+    fputc('"', out);
+}
+
+static void write_family(FILE* out, const char* name, const char* type, const char* help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void write_latency_histogram(FILE* out, int stage, const char* plugin, const char* kind,
+                                    const latency_histogram_t* histogram) {
+    for (size_t b = 0; b < sizeof(metrics_latency_bounds) / sizeof(metrics_latency_bounds[0]); ++b) {
+        fputs("analyzer_stage_latency_seconds_bucket{", out);
+        write_stage_labels(out, stage, plugin);
+        uint64_t bound_ns = (uint64_t)(metrics_latency_bounds[b] * 1e9 + 0.5);
+        fprintf(out, ",kind=\"%s\",le=\"%g\"} %llu\n", kind, metrics_latency_bounds[b],
+                (unsigned long long)latency_histogram_count_at_most(histogram, bound_ns));
+    }
+    fputs("analyzer_stage_latency_seconds_bucket{", out);
+    write_stage_labels(out, stage, plugin);
+    fprintf(out, ",kind=\"%s\",le=\"+Inf\"} %llu\n", kind, (unsigned long long)histogram->total);
+    fputs("analyzer_stage_latency_seconds_sum{", out);
+    write_stage_labels(out, stage, plugin);
+    fprintf(out, ",kind=\"%s\"} %.9f\n", kind, latency_histogram_sum(histogram) / 1e9);
+    fputs("analyzer_stage_latency_seconds_count{", out);
+    write_stage_labels(out, stage, plugin);
+    fprintf(out, ",kind=\"%s\"} %llu\n", kind, (unsigned long long)histogram->total);
+}
+
+// Prometheus exposition text of every stage's counters, queue depth and
+// latency histograms, plus the allocator's totals (--metrics)
+// Stages without an entry point (older plugins) are left out of its families
+void render_metrics(FILE* out, void* ctx) {
+    const metrics_source_t* source = ctx;
+    int count = source->plugin_count;
+    struct {
+        stage_stats_t stats;
+        int has_stats;
+        int depth;
+        int capacity;
+        int has_depth;
+    }* stages = calloc(count, sizeof(*stages));
+    stage_latency_t* latency = malloc(sizeof(*latency));
+    if (!stages || !latency) {
+        free(stages);
+        free(latency);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        const plugin_handle_t* plugin = &source->plugins[i];
+        stages[i].has_stats = plugin->get_stats && plugin->get_stats(&stages[i].stats) == NULL;
+        stages[i].has_depth = plugin->get_queue_depth &&
+                              plugin->get_queue_depth(&stages[i].depth, &stages[i].capacity) == NULL;
+    }
+
+    write_family(out, "analyzer_uptime_seconds", "gauge", "Seconds since the pipeline started.");
+    fprintf(out, "analyzer_uptime_seconds %.3f\n", (stage_stats_now_ns() - source->start_ns) / 1e9);
+
+    static const struct {
+        const char* name;
+        const char* help;
+        size_t offset;
+        double scale; // Nanosecond counters are exported in seconds
+    } counters[] = {
+        { "analyzer_stage_items_in_total", "Lines the stage took from its queue.",
+          offsetof(stage_stats_t, items_in), 1 },
+        { "analyzer_stage_items_out_total", "Lines the stage's transform produced.",
+          offsetof(stage_stats_t, items_out), 1 },
+        { "analyzer_stage_errors_total", "Lines the stage's transform failed on (dropped).",
+          offsetof(stage_stats_t, errors), 1 },
+        { "analyzer_stage_bytes_in_total", "Bytes of the messages the stage took.",
+          offsetof(stage_stats_t, bytes_in), 1 },
+        { "analyzer_stage_bytes_out_total", "Bytes of the messages the stage produced.",
+          offsetof(stage_stats_t, bytes_out), 1 },
+        { "analyzer_stage_process_seconds_total", "Time inside the stage's transform.",
+          offsetof(stage_stats_t, process_ns), 1e-9 },
+        { "analyzer_stage_input_wait_seconds_total", "Time the stage's thread waited on an empty queue.",
+          offsetof(stage_stats_t, get_wait_ns), 1e-9 },
+        { "analyzer_stage_full_wait_seconds_total", "Time producers waited on the stage's full queue.",
+          offsetof(stage_stats_t, put_wait_ns), 1e-9 },
+        { "analyzer_stage_cache_hits_total", "Lines the stage's result cache answered.",
+          offsetof(stage_stats_t, cache_hits), 1 },
+        { "analyzer_stage_cache_misses_total", "Lines the stage's result cache had to pass to the transform.",
+          offsetof(stage_stats_t, cache_misses), 1 },
+        { "analyzer_stage_cache_evictions_total", "Entries the stage's result cache dropped to stay within budget.",
+          offsetof(stage_stats_t, cache_evictions), 1 },
+    };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); ++c) {
+        write_family(out, counters[c].name, "counter", counters[c].help);
+        for (int i = 0; i < count; ++i) {
+            if (!stages[i].has_stats) continue;
+            uint64_t value = *(const uint64_t*)((const char*)&stages[i].stats + counters[c].offset);
+            fprintf(out, "%s{", counters[c].name);
+            write_stage_labels(out, i + 1, source->plugins[i].name);
+            if (counters[c].scale == 1) {
+                fprintf(out, "} %llu\n", (unsigned long long)value);
+            } else {
+                fprintf(out, "} %.9f\n", value * counters[c].scale);
+            }
+        }
+    }
+
+    write_family(out, "analyzer_stage_queue_depth", "gauge", "Items waiting in the stage's queue.");
+    for (int i = 0; i < count; ++i) {
+        if (!stages[i].has_depth) continue;
+        fputs("analyzer_stage_queue_depth{", out);
+        write_stage_labels(out, i + 1, source->plugins[i].name);
+        fprintf(out, "} %d\n", stages[i].depth);
+    }
+    write_family(out, "analyzer_stage_queue_capacity", "gauge", "Size of the stage's queue.");
+    for (int i = 0; i < count; ++i) {
+        if (!stages[i].has_depth) continue;
+        fputs("analyzer_stage_queue_capacity{", out);
+        write_stage_labels(out, i + 1, source->plugins[i].name);
+        fprintf(out, "} %d\n", stages[i].capacity);
+    }
+
+    write_family(out, "analyzer_stage_latency_seconds", "histogram",
+                 "Time in the stage's queue, in its transform, and since ingest (end-to-end at the last stage).");
+    for (int i = 0; i < count; ++i) {
+        const plugin_handle_t* plugin = &source->plugins[i];
+        if (!plugin->get_latency || plugin->get_latency(latency) != NULL) continue;
+        write_latency_histogram(out, i + 1, plugin->name, "queue", &latency->queue);
+        write_latency_histogram(out, i + 1, plugin->name, "service", &latency->service);
+        write_latency_histogram(out, i + 1, plugin->name, "since_ingest", &latency->since_ingest);
+    }
+
+    // Whole-process allocator view - queue copies and results all come from malloc
+    struct mallinfo2 heap = mallinfo2();
+    static const char* const heap_help[][2] = {
+        { "analyzer_malloc_arena_bytes", "Bytes the allocator got from the system with brk." },
+        { "analyzer_malloc_mmap_bytes", "Bytes in blocks the allocator mapped on their own." },
+        { "analyzer_malloc_in_use_bytes", "Bytes handed out by malloc and not freed." },
+        { "analyzer_malloc_free_bytes", "Bytes free in the allocator's arenas." },
+    };
+    const size_t heap_values[] = { heap.arena, heap.hblkhd, heap.uordblks + heap.hblkhd, heap.fordblks };
+    for (size_t h = 0; h < sizeof(heap_values) / sizeof(heap_values[0]); ++h) {
+        write_family(out, heap_help[h][0], "gauge", heap_help[h][1]);
+        fprintf(out, "%s %zu\n", heap_help[h][0], heap_values[h]);
+    }
+    free(stages);
+    free(latency);
+}
+
 // Cleanup temporary plugin files created during the run - helps me with double plugined
 void cleanup_temp_plugin_files() {
     char cleanup_cmd[256];
-    snprintf(cleanup_cmd, sizeof(cleanup_cmd), "rm -f output/*_temp_%d_*.so", getpid());
+    snprintf(cleanup_cmd, sizeof(cleanup_cmd), "rm -f " ANALYZER_PLUGIN_DIR "/*_temp_%d_*.so", getpid());
     system(cleanup_cmd);
 }
 
@@ -70,6 +70,75 @@ run_test "Complex chain" 0 "./output/analyzer 12 uppercaser rotator flipper logg
 run_test "Multiple inputs" 0 "./output/analyzer 20 uppercaser logger" "\\[logger\\] HELLO" "hello\nworld\ntest\n<END>"
 run_test "Empty END" 0 "./output/analyzer 10 logger" "Pipeline shutdown complete" "<END>"
 run_test "Small queue" 0 "./output/analyzer 2 logger" "Pipeline shutdown complete" "a\nb\nc\n<END>"
+LONG_LINE="a$(printf 'x%.0s' {1..3000})b"
+run_test "Line over 1024 bytes" 0 "./output/analyzer 5 rotator logger" "\\[logger\\] baxxx" "${LONG_LINE}\n<END>"
+run_test "Input without END" 0 "./output/analyzer 5 uppercaser logger" "\\[logger\\] LAST" "first\nlast"
+INPUT_FILE=$(mktemp)
+FRAMED_FILE=$(mktemp)
+trap 'rm -f "$INPUT_FILE" "$FRAMED_FILE"' EXIT
+printf 'from file\nsecond line\n<END>\nafter end\n' > "$INPUT_FILE"
+run_test "Input file" 0 "./output/analyzer --input $INPUT_FILE 5 uppercaser logger" "\\[logger\\] SECOND LINE" ""
+run_test "Missing input file" 1 "./output/analyzer --input /nonexistent/input.txt 5 logger" "Cannot open input" ""
+run_test "io_uring engine" 0 "./output/analyzer --io-engine uring 5 uppercaser logger" "\\[logger\\] WORLD" "hello\nworld\n<END>"
+run_test "io_uring input file" 0 "./output/analyzer --io-engine uring --input $INPUT_FILE 5 logger" "\\[logger\\] second line" ""
+run_test "Bad io engine" 1 "./output/analyzer --io-engine aio 5 logger" "Usage:" ""
+printf '\x00\x00\x00\x09two\nlines\x00\x00\x00\x03abc' > "$FRAMED_FILE"
+run_test "u32 framing" 0 "./output/analyzer --framing u32 --input $FRAMED_FILE 5 uppercaser logger" "^LINES$" ""
+printf '\x05hello\x03bye' > "$FRAMED_FILE"
+run_test "varint framing" 0 "./output/analyzer --framing varint --input $FRAMED_FILE 5 logger" "\\[logger\\] bye" ""
+run_test "varint framing, streamed" 0 "./output/analyzer --io-engine uring --framing varint --input $FRAMED_FILE 5 logger" "\\[logger\\] hello" ""
+printf '\x00\x00\x00\x09short' > "$FRAMED_FILE"
+run_test "Truncated frame" 1 "./output/analyzer --framing u32 --input $FRAMED_FILE 5 logger" "Failed to read input" ""
+run_test "Bad framing" 1 "./output/analyzer --framing csv 5 logger" "Usage:" ""
+run_test "Sink to stdout" 0 "./output/analyzer --sink stdout 5 uppercaser flipper" "^DLROW$" "hello\nworld\n<END>"
+run_test "Sink to file" 0 "./output/analyzer --sink file:$FRAMED_FILE --sink-flush every 5 rotator" "Pipeline shutdown complete" "hello\n<END>"
+run_test "Sink file contents" 0 "cat $FRAMED_FILE" "^ohell$" ""
+run_test "Bad sink" 1 "./output/analyzer --sink tcp:1234 5 logger" "Cannot open sink" ""
+run_test "Bad sink flush" 1 "./output/analyzer --sink stdout --sink-flush lines:3 5 logger" "Usage:" ""
+printf 'second file\n' > "$FRAMED_FILE"
+run_test "Several inputs" 0 "./output/analyzer --input $INPUT_FILE --input $FRAMED_FILE 5 uppercaser logger" "\\[logger\\] SECOND FILE" ""
+run_test "Several inputs, END per file" 0 "./output/analyzer --ordered --input $INPUT_FILE --input $FRAMED_FILE 5 logger" "\\[logger\\] second file" ""
+run_test "Several inputs, one missing" 1 "./output/analyzer --input $INPUT_FILE --input /nonexistent/input.txt 5 logger" "Cannot open input" ""
+run_test "Bad reader count" 1 "./output/analyzer --readers 0 --input $INPUT_FILE 5 logger" "Usage:" ""
+run_test "Chunked lines" 0 "./output/analyzer --chunk-lines 2 5 uppercaser rotator logger" "\\[logger\\] CAB" "abc\ndef\nabc\n<END>"
+run_test "Chunked lines to sink" 0 "./output/analyzer --chunk-lines 64 --sink stdout 5 flipper" "^cba$" "abc\ndef\n<END>"
+run_test "Chunk-like line stays one line" 0 "./output/analyzer 5 uppercaser logger" "\\[logger\\] .2:1,1:AB$" "\x1e2:1,1:ab\n<END>"
+run_test "Chunk-like line in a chunk" 0 "./output/analyzer --chunk-lines 4 --sink stdout 5 uppercaser" "^.2:1,1:AB$" "\x1e2:1,1:ab\nxy\n<END>"
+run_test "Bad chunk size" 1 "./output/analyzer --chunk-lines many 5 logger" "Usage:" ""
+printf 'packed line\n<END>\n' | gzip > "$FRAMED_FILE"
+run_test "gzip input file" 0 "./output/analyzer --input $FRAMED_FILE 5 uppercaser logger" "\\[logger\\] PACKED LINE" ""
+printf '\x1f\x8b\x08\x00broken' > "$FRAMED_FILE"
+run_test "Corrupt gzip input" 1 "./output/analyzer --input $FRAMED_FILE 5 logger" "Failed to read input" ""
+run_test "Several inputs, one corrupt" 1 "./output/analyzer --input $INPUT_FILE --input $FRAMED_FILE 5 logger" "\\[logger\\] second line" ""
+run_test "Read-ahead of one line" 0 "./output/analyzer --readahead 1 2 uppercaser logger" "\\[logger\\] C" "a\nb\nc\n<END>\nnot read"
+run_test "Read-ahead off" 0 "./output/analyzer --readahead 0 5 logger" "\\[logger\\] world" "hello\nworld\n<END>"
+run_test "Bad read-ahead" 1 "./output/analyzer --readahead -1 5 logger" "Usage:" ""
+run_test "Startup timings" 0 "./output/analyzer --timings 5 rotator rotator logger" "rotator  *dlopen" "ab\n<END>"
+run_test "Stage stats" 0 "./output/analyzer --stats 5 uppercaser rotator logger" "rotator  *2  *4  *2  *4 " "ab\ncd\n<END>"
+run_test "Stage stats of chunks" 0 "./output/analyzer --stats --chunk-lines 4 5 flipper logger" "flipper  *3 " "ab\ncd\nef\n<END>"
+run_test "Latency percentiles" 0 "./output/analyzer --latency 5 uppercaser rotator logger" "logger  *end-to-end  *2 " "ab\ncd\n<END>"
+run_test "Latency of chunks" 0 "./output/analyzer --latency --chunk-lines 4 5 flipper logger" "flipper  *queue  *1 " "ab\ncd\nef\n<END>"
+run_test "Trace export" 0 "./output/analyzer --trace $FRAMED_FILE --trace-sample 1 5 uppercaser logger" "Pipeline shutdown complete" "ab\ncd\n<END>"
+run_test "Trace file contents" 0 "cat $FRAMED_FILE" "stage 2: logger" ""
+run_test "Bottleneck report" 0 "./output/analyzer --bottleneck 5 uppercaser logger" "uppercaser  *5 " "ab\ncd\n<END>"
+run_test "Metrics file" 0 "./output/analyzer --metrics file:$FRAMED_FILE 5 uppercaser logger" "Pipeline shutdown complete" "ab\ncd\n<END>"
+run_test "Metrics file contents" 0 "cat $FRAMED_FILE" "analyzer_stage_items_out_total{stage=\"2\",plugin=\"logger\"} 2" ""
+run_test "Metrics of a cached stage" 0 "env PLUGIN_CACHE_BYTES=65536 ./output/analyzer --metrics file:$FRAMED_FILE 5 uppercaser logger" "Pipeline shutdown complete" "ab\nab\ncd\n<END>"
+run_test "Cache hits in metrics" 0 "cat $FRAMED_FILE" "analyzer_stage_cache_hits_total{stage=\"1\",plugin=\"uppercaser\"} 1" ""
+run_test "Bad metrics target" 1 "./output/analyzer --metrics tcp:9100 5 logger" "Cannot export metrics" ""
+run_test "Bad trace sample" 1 "./output/analyzer --trace $FRAMED_FILE --trace-sample 0 5 logger" "Usage:" ""
+run_test "Connect without daemon" 1 "./output/analyzer --connect /nonexistent/analyzer.sock" "Cannot connect" ""
+run_test "Unknown option" 1 "./output/analyzer --bogus 5 logger" "Usage:" ""
+run_test "Help" 0 "./output/analyzer --help" "Print this help and exit" ""
+run_test "UTF-8 flipper" 0 "./output/analyzer 5 flipper logger" "\\[logger\\] olléh" "héllo\n<END>"
+run_test "UTF-8 rotator" 0 "./output/analyzer 5 rotator logger" "\\[logger\\] €abc" "abc€\n<END>"
+run_test "UTF-8 expander" 0 "./output/analyzer 5 expander logger" "\\[logger\\] h é l" "hél\n<END>"
+run_test "Byte text mode" 0 "env PLUGIN_TEXT_MODE=bytes ./output/analyzer 5 flipper flipper logger" "\\[logger\\] héllo" "héllo\n<END>"
+run_test "Cached uppercaser" 0 "env PLUGIN_CACHE_BYTES=65536 ./output/analyzer 5 uppercaser logger" "cache: 2 hits, 1 misses" "hi\nhi\nhi\n<END>"
+run_test "Bad cache budget falls back" 0 "env PLUGIN_CACHE_BYTES=64k ./output/analyzer 5 uppercaser logger" "invalid PLUGIN_CACHE_BYTES .64k., cache disabled" "hi\n<END>"
+run_test "Typewriter no delay" 0 "env TYPEWRITER_DELAY_US=0 ./output/analyzer 5 typewriter" "\\[typewriter\\] hello" "hello\n<END>"
+run_test "Typewriter short delay" 0 "env TYPEWRITER_DELAY_US=1000 ./output/analyzer 5 typewriter uppercaser logger" "\\[typewriter\\] hello" "hello\nworld\n<END>"
+run_test "Bad typewriter delay" 1 "env TYPEWRITER_DELAY_US=abc ./output/analyzer 5 typewriter" "Initialization failed" "<END>"
 
 # Invalid tests
 run_test "No arguments" 1 "./output/analyzer" "Usage:" ""
@@ -81,6 +150,179 @@ run_test "Decimal queue" 1 "./output/analyzer 10.5 logger" "Usage:" ""
 run_test "Leading zero" 1 "./output/analyzer 01 logger" "Usage:" ""
 run_test "Bad plugin" 1 "./output/analyzer 10 nonexistent" "dlopen failed" ""
 
+# Daemon: two client streams through one running pipeline, then SIGTERM
+echo "Daemon test"
+DAEMON_SOCKET="$INPUT_FILE.sock"
+DAEMON_OUT=$(mktemp)
+./output/analyzer --daemon "$DAEMON_SOCKET" 5 uppercaser logger > "$DAEMON_OUT" 2>&1 &
+DAEMON_PID=$!
+for i in {1..50}; do
+    [ -S "$DAEMON_SOCKET" ] && break
+    sleep 0.1
+done
+CLIENT_OUT=$(printf 'first\n' | ./output/analyzer --connect "$DAEMON_SOCKET"; printf 'second\n<END>\n' | ./output/analyzer --connect "$DAEMON_SOCKET")
+kill -TERM $DAEMON_PID
+wait $DAEMON_PID
+DAEMON_EXIT=$?
+if [ "$DAEMON_EXIT" -eq 0 ] && [ "$CLIENT_OUT" = "$(printf 'OK 1\nOK 1')" ] && \
+   grep -q "\\[logger\\] FIRST" "$DAEMON_OUT" && grep -q "\\[logger\\] SECOND" "$DAEMON_OUT" && \
+   grep -q "Pipeline shutdown complete" "$DAEMON_OUT" && [ ! -e "$DAEMON_SOCKET" ]; then
+    echo -e "${GREEN}PASS${NC} - Daemon test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Daemon test"
+    echo "Clients: $CLIENT_OUT"
+    cat "$DAEMON_OUT"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$DAEMON_OUT"
+echo ""
+
+# Hot swap: a stage switches builds on SIGHUP while input is still coming
+echo "Hot swap test"
+SWAP_FIFO="$INPUT_FILE.fifo"
+SWAP_OUT=$(mktemp)
+mkfifo "$SWAP_FIFO"
+cp output/rotator.so output/hotswapcheck.so
+./output/analyzer --hot-swap --input "$SWAP_FIFO" 5 hotswapcheck logger > "$SWAP_OUT" 2>&1 &
+SWAP_PID=$!
+exec 7>"$SWAP_FIFO"
+printf 'abc\n' >&7
+sleep 0.3
+cp output/flipper.so output/hotswapcheck.so.new && mv output/hotswapcheck.so.new output/hotswapcheck.so
+kill -HUP $SWAP_PID
+sleep 0.3
+printf 'abcd\n<END>\n' >&7
+exec 7>&-
+wait $SWAP_PID
+SWAP_EXIT=$?
+if [ "$SWAP_EXIT" -eq 0 ] && grep -q "\\[logger\\] cab" "$SWAP_OUT" && grep -q "\\[logger\\] dcba" "$SWAP_OUT"; then
+    echo -e "${GREEN}PASS${NC} - Hot swap test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Hot swap test"
+    cat "$SWAP_OUT"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$SWAP_OUT" "$SWAP_FIFO" output/hotswapcheck.so
+echo ""
+
+# A sync-engine logger has no background state, so it swaps like any other stage
+echo "Hot swap sync logger test"
+SWAP_OUT=$(mktemp)
+mkfifo "$SWAP_FIFO"
+cp output/logger.so output/hotswapcheck.so
+./output/analyzer --hot-swap --io-engine sync --input "$SWAP_FIFO" 5 uppercaser hotswapcheck > "$SWAP_OUT" 2>&1 &
+SWAP_PID=$!
+exec 7>"$SWAP_FIFO"
+printf 'abc\n' >&7
+sleep 0.3
+cp output/logger.so output/hotswapcheck.so.new && mv output/hotswapcheck.so.new output/hotswapcheck.so
+kill -HUP $SWAP_PID
+sleep 0.3
+printf 'abcd\n<END>\n' >&7
+exec 7>&-
+wait $SWAP_PID
+SWAP_EXIT=$?
+if [ "$SWAP_EXIT" -eq 0 ] && grep -q "switched to the reloaded build" "$SWAP_OUT" && \
+   grep -q "\\[logger\\] ABC$" "$SWAP_OUT" && grep -q "\\[logger\\] ABCD$" "$SWAP_OUT"; then
+    echo -e "${GREEN}PASS${NC} - Hot swap sync logger test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Hot swap sync logger test"
+    cat "$SWAP_OUT"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$SWAP_OUT" "$SWAP_FIFO" output/hotswapcheck.so
+echo ""
+
+# Hot swap of a stage with background state (the uring logger's buffered writer) is refused
+echo "Hot swap refused test"
+SWAP_OUT=$(mktemp)
+mkfifo "$SWAP_FIFO"
+cp output/logger.so output/hotswapcheck.so
+./output/analyzer --hot-swap --io-engine uring --input "$SWAP_FIFO" 5 uppercaser hotswapcheck > "$SWAP_OUT" 2>&1 &
+SWAP_PID=$!
+exec 7>"$SWAP_FIFO"
+printf 'abc\n' >&7
+sleep 0.3
+cp output/logger.so output/hotswapcheck.so.new && mv output/hotswapcheck.so.new output/hotswapcheck.so
+kill -HUP $SWAP_PID
+sleep 0.3
+printf 'abcd\n<END>\n' >&7
+exec 7>&-
+wait $SWAP_PID
+SWAP_EXIT=$?
+if [ "$SWAP_EXIT" -eq 0 ] && grep -q "keeps background state" "$SWAP_OUT" && \
+   grep -q "\\[logger\\] ABC$" "$SWAP_OUT" && grep -q "\\[logger\\] ABCD$" "$SWAP_OUT"; then
+    echo -e "${GREEN}PASS${NC} - Hot swap refused test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Hot swap refused test"
+    cat "$SWAP_OUT"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$SWAP_OUT" "$SWAP_FIFO" output/hotswapcheck.so
+echo ""
+
+echo "Stats on SIGUSR1 test"
+STATS_FIFO="$INPUT_FILE.fifo"
+STATS_OUT=$(mktemp)
+mkfifo "$STATS_FIFO"
+./output/analyzer --input "$STATS_FIFO" 5 uppercaser logger > "$STATS_OUT" 2>&1 &
+STATS_PID=$!
+exec 7>"$STATS_FIFO"
+printf 'abc\n' >&7
+sleep 0.3
+kill -USR1 $STATS_PID
+sleep 0.3
+printf '<END>\n' >&7
+exec 7>&-
+wait $STATS_PID
+STATS_EXIT=$?
+if [ "$STATS_EXIT" -eq 0 ] && grep -q "uppercaser  *1  *3 " "$STATS_OUT" && grep -q "Pipeline shutdown complete" "$STATS_OUT"; then
+    echo -e "${GREEN}PASS${NC} - Stats on SIGUSR1 test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Stats on SIGUSR1 test"
+    cat "$STATS_OUT"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$STATS_OUT" "$STATS_FIFO"
+echo ""
+
+echo "Metrics over HTTP test"
+METRICS_FIFO="$INPUT_FILE.fifo"
+METRICS_OUT=$(mktemp)
+METRICS_SCRAPE=$(mktemp)
+METRICS_PORT=19091
+mkfifo "$METRICS_FIFO"
+./output/analyzer --metrics http:$METRICS_PORT --input "$METRICS_FIFO" 5 uppercaser logger > "$METRICS_OUT" 2>&1 &
+METRICS_PID=$!
+exec 7>"$METRICS_FIFO"
+printf 'abc\n' >&7
+sleep 0.3
+if exec 3<>/dev/tcp/127.0.0.1/$METRICS_PORT; then
+    printf 'GET /metrics HTTP/1.0\r\n\r\n' >&3
+    timeout 5 cat <&3 > "$METRICS_SCRAPE"
+    exec 3<&-
+fi
+printf '<END>\n' >&7
+exec 7>&-
+wait $METRICS_PID
+METRICS_EXIT=$?
+if [ "$METRICS_EXIT" -eq 0 ] && grep -q "^HTTP/1.0 200 OK" "$METRICS_SCRAPE" &&
+   grep -q "analyzer_stage_items_in_total{stage=\"1\",plugin=\"uppercaser\"} 1" "$METRICS_SCRAPE"; then
+    echo -e "${GREEN}PASS${NC} - Metrics over HTTP test"
+    TESTS_PASSED=$((TESTS_PASSED + 1))
+else
+    echo -e "${RED}FAIL${NC} - Metrics over HTTP test"
+    cat "$METRICS_OUT" "$METRICS_SCRAPE"
+fi
+TESTS_TOTAL=$((TESTS_TOTAL + 1))
+rm -f "$METRICS_OUT" "$METRICS_SCRAPE" "$METRICS_FIFO"
+echo ""
+
 # Memory test
 echo "Memory stress test"
 STRESS_INPUT=""
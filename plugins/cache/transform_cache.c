@@ -0,0 +1,250 @@
+#include "transform_cache.h"
+#include "../stats/stage_stats.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CACHE_MIN_BUCKETS 64
+#define CACHE_ENTRY_OVERHEAD (sizeof(transform_cache_entry_t) + sizeof(int))
+
+
+uint64_t transform_cache_hash(const char* data, size_t len)
+{
+    const uint64_t mul = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = 0xCBF29CE484222325ULL ^ (len * mul);
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * mul;
+        h ^= h >> 29;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * mul;
+
+    // Final avalanche so the low bits (bucket index) depend on every input byte
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+int transform_cache_init(transform_cache_t* cache, size_t budget)
+{
+    if (cache == NULL) {
+        fprintf(stderr, "Error: transform_cache_init received NULL.\n");
+        return -1;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+    cache->buckets = malloc(sizeof(int) * CACHE_MIN_BUCKETS);
+    if (cache->buckets == NULL) {
+        fprintf(stderr, "Error: Failed to allocate cache buckets.\n");
+        return -1;
+    }
+    for (int i = 0; i < CACHE_MIN_BUCKETS; ++i) {
+        cache->buckets[i] = -1;
+    }
+
+    cache->bucket_count = CACHE_MIN_BUCKETS;
+    cache->free_head = -1;
+    cache->budget = budget;
+    return 0;
+}
+
+static void free_entry_data(transform_cache_entry_t* entry)
+{
+    free(entry->input);
+    free(entry->output);
+    entry->input = NULL;
+    entry->output = NULL;
+    entry->live = 0;
+}
+
+void transform_cache_destroy(transform_cache_t* cache)
+{
+    if (cache == NULL) {
+        fprintf(stderr, "Error: transform_cache_destroy received NULL.\n");
+        return;
+    }
+
+    for (int i = 0; i < cache->entry_count; ++i) {
+        if (cache->entries[i].live) {
+            free_entry_data(&cache->entries[i]);
+        }
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries = NULL;
+    cache->buckets = NULL;
+    cache->entry_count = cache->entry_capacity = cache->live_count = 0;
+    cache->used = 0;
+}
+
+const char* transform_cache_lookup(transform_cache_t* cache, uint64_t hash,
+                                   const char* input, size_t input_len, size_t* output_len)
+{
+    int index = cache->buckets[hash & (uint64_t)(cache->bucket_count - 1)];
+    while (index >= 0) {
+        transform_cache_entry_t* entry = &cache->entries[index];
+        if (entry->hash == hash && entry->input_len == input_len &&
+            memcmp(entry->input, input, input_len) == 0) {
+            entry->referenced = 1;
+            stage_counter_add(&cache->hits, 1);
+            if (output_len) *output_len = entry->output_len;
+            return entry->output;
+        }
+        index = entry->next;
+    }
+
+    stage_counter_add(&cache->misses, 1);
+    return NULL;
+}
+
+static void unlink_entry(transform_cache_t* cache, int index)
+{
+    transform_cache_entry_t* entry = &cache->entries[index];
+    int* link = &cache->buckets[entry->hash & (uint64_t)(cache->bucket_count - 1)];
+    while (*link != index) {
+        link = &cache->entries[*link].next;
+    }
+    *link = entry->next;
+
+    cache->used -= entry->input_len + entry->output_len + CACHE_ENTRY_OVERHEAD;
+    cache->live_count--;
+    free_entry_data(entry);
+
+    entry->next = cache->free_head;
+    cache->free_head = index;
+}
+
+// CLOCK: sweep the hand, giving referenced entries a second chance
+static void evict_one(transform_cache_t* cache)
+{
+    while (1) {
+        if (cache->hand >= cache->entry_count) {
+            cache->hand = 0;
+        }
+        transform_cache_entry_t* entry = &cache->entries[cache->hand];
+        int index = cache->hand++;
+
+        if (!entry->live) continue;
+        if (entry->referenced) {
+            entry->referenced = 0;
+            continue;
+        }
+
+        unlink_entry(cache, index);
+        stage_counter_add(&cache->evictions, 1);
+        return;
+    }
+}
+
+// Double the bucket array once chains get longer than one entry on average
+static void grow_buckets(transform_cache_t* cache)
+{
+    int new_count = cache->bucket_count * 2;
+    int* buckets = malloc(sizeof(int) * new_count);
+    if (buckets == NULL) return; // keep the old index - lookups just get slower
+
+    for (int i = 0; i < new_count; ++i) {
+        buckets[i] = -1;
+    }
+    for (int i = 0; i < cache->entry_count; ++i) {
+        transform_cache_entry_t* entry = &cache->entries[i];
+        if (!entry->live) continue;
+        int b = (int)(entry->hash & (uint64_t)(new_count - 1));
+        entry->next = buckets[b];
+        buckets[b] = i;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = new_count;
+}
+
+static int take_slot(transform_cache_t* cache)
+{
+    if (cache->free_head >= 0) {
+        int index = cache->free_head;
+        cache->free_head = cache->entries[index].next;
+        return index;
+    }
+
+    if (cache->entry_count == cache->entry_capacity) {
+        int new_capacity = cache->entry_capacity ? cache->entry_capacity * 2 : 64;
+        transform_cache_entry_t* grown = realloc(cache->entries, sizeof(*grown) * new_capacity);
+        if (grown == NULL) return -1;
+        cache->entries = grown;
+        cache->entry_capacity = new_capacity;
+    }
+    return cache->entry_count++;
+}
+
+int transform_cache_insert(transform_cache_t* cache, uint64_t hash,
+                           const char* input, size_t input_len,
+                           const char* output, size_t output_len)
+{
+    size_t cost = input_len + output_len + CACHE_ENTRY_OVERHEAD;
+    if (cost > cache->budget) {
+        return -1;
+    }
+
+    while (cache->used + cost > cache->budget && cache->live_count > 0) {
+        evict_one(cache);
+    }
+
+    char* input_copy = malloc(input_len + 1);
+    char* output_copy = malloc(output_len + 1);
+    int index = (input_copy && output_copy) ? take_slot(cache) : -1;
+    if (index < 0) {
+        free(input_copy);
+        free(output_copy);
+        return -1;
+    }
+    memcpy(input_copy, input, input_len);
+    input_copy[input_len] = '\0';
+    memcpy(output_copy, output, output_len);
+    output_copy[output_len] = '\0';
+
+    transform_cache_entry_t* entry = &cache->entries[index];
+    entry->hash = hash;
+    entry->input = input_copy;
+    entry->output = output_copy;
+    entry->input_len = input_len;
+    entry->output_len = output_len;
+    entry->referenced = 0;
+    entry->live = 1;
+
+    int b = (int)(hash & (uint64_t)(cache->bucket_count - 1));
+    entry->next = cache->buckets[b];
+    cache->buckets[b] = index;
+
+    cache->used += cost;
+    cache->live_count++;
+
+    if (cache->live_count > cache->bucket_count) {
+        grow_buckets(cache);
+    }
+    return 0;
+}
+
+void transform_cache_clear(transform_cache_t* cache)
+{
+    for (int i = 0; i < cache->entry_count; ++i) {
+        if (cache->entries[i].live) {
+            free_entry_data(&cache->entries[i]);
+        }
+    }
+    for (int i = 0; i < cache->bucket_count; ++i) {
+        cache->buckets[i] = -1;
+    }
+    cache->entry_count = 0;
+    cache->free_head = -1;
+    cache->live_count = 0;
+    cache->hand = 0;
+    cache->used = 0;
+}
@@ -0,0 +1,95 @@
+#ifndef TRANSFORM_CACHE_H
+#define TRANSFORM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One cached input -> output pair
+typedef struct
+{
+    uint64_t hash; // Hash of the input
+    char* input; // Copy of the input (key)
+    char* output; // Copy of the transform result
+    size_t input_len; // Length of input
+    size_t output_len; // Length of output
+    int next; // Next entry in the same bucket, -1 terminates
+    int referenced; // CLOCK reference bit, set on every hit
+    int live; // Slot holds an entry
+} transform_cache_entry_t;
+
+// Transform result cache with a byte budget and CLOCK eviction
+// Not thread safe - each stage's cache is only used by its consumer thread
+// (the hit, miss and eviction counters may be read with stage_counter_read)
+typedef struct
+{
+    transform_cache_entry_t* entries; // Entry slots, CLOCK hand walks over them
+    int entry_count; // Slots in use (live or free)
+    int entry_capacity; // Allocated slots
+    int free_head; // First free slot (chained through next), -1 if none
+    int* buckets; // Hash index - first entry of each bucket, -1 if empty
+    int bucket_count; // Power of two
+    int live_count; // Number of live entries
+    int hand; // CLOCK hand
+    size_t budget; // Maximum bytes held (keys, values and slot overhead)
+    size_t used; // Bytes currently held
+    uint64_t hits; // Lookups answered from the cache
+    uint64_t misses; // Lookups that had to run the transform
+    uint64_t evictions; // Entries dropped to stay within budget
+} transform_cache_t;
+
+/**
+* Hash a byte string (8 bytes per step)
+* @param data Bytes to hash
+* @param len Number of bytes
+* @return 64 bit hash
+*/
+uint64_t transform_cache_hash(const char* data, size_t len);
+
+/**
+* Initialize an empty cache
+* @param cache Pointer to cache structure
+* @param budget Maximum number of bytes the cache may hold
+* @return 0 on success, -1 on failure
+*/
+int transform_cache_init(transform_cache_t* cache, size_t budget);
+
+/**
+* Free every entry and the cache's own arrays
+* @param cache Pointer to cache structure
+*/
+void transform_cache_destroy(transform_cache_t* cache);
+
+/**
+* Look up a cached result and count the hit or miss
+* @param cache Pointer to cache structure
+* @param hash transform_cache_hash of input
+* @param input Input string
+* @param input_len Length of input
+* @param output_len Set to the length of the result on a hit (may be NULL)
+* @return Cached result (owned by the cache) or NULL on a miss
+*/
+const char* transform_cache_lookup(transform_cache_t* cache, uint64_t hash,
+                                   const char* input, size_t input_len, size_t* output_len);
+
+/**
+* Store a result, evicting old entries if needed
+* Results larger than the whole budget are not stored
+* @param cache Pointer to cache structure
+* @param hash transform_cache_hash of input
+* @param input Input string (copied)
+* @param input_len Length of input
+* @param output Transform result (copied)
+* @param output_len Length of output
+* @return 0 if stored, -1 if skipped or allocation failed
+*/
+int transform_cache_insert(transform_cache_t* cache, uint64_t hash,
+                           const char* input, size_t input_len,
+                           const char* output, size_t output_len);
+
+/**
+* Drop every entry, keeping the counters (used when the transform changes)
+* @param cache Pointer to cache structure
+*/
+void transform_cache_clear(transform_cache_t* cache);
+
+#endif // TRANSFORM_CACHE_H
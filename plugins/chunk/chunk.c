@@ -0,0 +1,136 @@
+#include "chunk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Parse a decimal number ending at `stop`; returns the position after it or NULL
+static const char* parse_number(const char* p, const char* end, char stop, size_t* value)
+{
+    size_t result = 0;
+    const char* start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        size_t next = result * 10 + (size_t)(*p - '0');
+        if (next < result) return NULL; // overflow
+        result = next;
+        p++;
+    }
+    if (p == start || p == end || *p != stop) {
+        return NULL;
+    }
+    *value = result;
+    return p + 1;
+}
+
+static int view_reserve(chunk_view_t* view, int count)
+{
+    if (count <= view->capacity) {
+        return 0;
+    }
+    size_t* offsets = realloc(view->offsets, sizeof(size_t) * (size_t)count);
+    if (offsets == NULL) return -1;
+    view->offsets = offsets;
+    size_t* lengths = realloc(view->lengths, sizeof(size_t) * (size_t)count);
+    if (lengths == NULL) return -1;
+    view->lengths = lengths;
+    view->capacity = count;
+    return 0;
+}
+
+int chunk_parse(const char* msg, size_t msg_len, chunk_view_t* view)
+{
+    const char* end = msg + msg_len;
+    if (msg_len == 0 || msg[0] != CHUNK_MARKER) {
+        return -1;
+    }
+
+    size_t count = 0;
+    const char* p = parse_number(msg + 1, end, ':', &count);
+    if (p == NULL || count == 0 || count > (size_t)(msg_len / 2) || view_reserve(view, (int)count) != 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        p = parse_number(p, end, i + 1 < count ? ',' : ':', &view->lengths[i]);
+        if (p == NULL) return -1;
+        total += view->lengths[i];
+    }
+
+    // The lines must exactly fill the rest of the message
+    size_t offset = (size_t)(p - msg);
+    if (total != msg_len - offset) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        view->offsets[i] = offset;
+        offset += view->lengths[i];
+    }
+    view->count = (int)count;
+    return 0;
+}
+
+void chunk_view_destroy(chunk_view_t* view)
+{
+    free(view->offsets);
+    free(view->lengths);
+    view->offsets = NULL;
+    view->lengths = NULL;
+    view->capacity = view->count = 0;
+}
+
+int chunk_builder_add(chunk_builder_t* builder, const char* line, size_t len)
+{
+    if (builder->count == builder->lines_cap) {
+        int new_cap = builder->lines_cap ? builder->lines_cap * 2 : 64;
+        size_t* lengths = realloc(builder->lengths, sizeof(size_t) * (size_t)new_cap);
+        if (lengths == NULL) return -1;
+        builder->lengths = lengths;
+        builder->lines_cap = new_cap;
+    }
+    if (builder->len + len > builder->cap) {
+        size_t new_cap = builder->cap ? builder->cap : 4096;
+        while (new_cap < builder->len + len) new_cap *= 2;
+        char* data = realloc(builder->data, new_cap);
+        if (data == NULL) return -1;
+        builder->data = data;
+        builder->cap = new_cap;
+    }
+
+    memcpy(builder->data + builder->len, line, len);
+    builder->len += len;
+    builder->lengths[builder->count++] = len;
+    return 0;
+}
+
+char* chunk_builder_finish(chunk_builder_t* builder, size_t* msg_len)
+{
+    // Header: marker, count, and up to 20 digits plus a separator per line
+    size_t header_cap = 2 + 21 + (size_t)builder->count * 21;
+    char* msg = malloc(header_cap + builder->len + 1);
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    size_t pos = 0;
+    msg[pos++] = CHUNK_MARKER;
+    pos += (size_t)sprintf(msg + pos, "%d:", builder->count);
+    for (int i = 0; i < builder->count; ++i) {
+        pos += (size_t)sprintf(msg + pos, "%zu%c", builder->lengths[i], i + 1 < builder->count ? ',' : ':');
+    }
+    memcpy(msg + pos, builder->data, builder->len);
+    pos += builder->len;
+    msg[pos] = '\0';
+
+    *msg_len = pos;
+    builder->len = 0;
+    builder->count = 0;
+    return msg;
+}
+
+void chunk_builder_destroy(chunk_builder_t* builder)
+{
+    free(builder->data);
+    free(builder->lengths);
+    memset(builder, 0, sizeof(*builder));
+}
@@ -0,0 +1,86 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stddef.h>
+
+// A chunk carries many lines in one queue message, so the queue operation,
+// wakeup and allocation are paid once per chunk instead of once per line.
+// It is still a C string, so it travels through the string-based plugin API:
+//
+//   "\x1e" <count> ":" <len1> "," <len2> "," ... <lenN> ":" <line1><line2>...<lineN>
+//
+// Lengths are decimal; the lines themselves are stored back to back with no
+// separator, so they may contain '\n'. Whether a message is a chunk travels
+// with it out of band (QUEUE_ITEM_CHUNK in its queue metadata), so an ordinary
+// line that happens to look like one is never split
+#define CHUNK_MARKER '\x1e' // ASCII record separator
+
+// Lines of a parsed chunk - offsets point into the message
+typedef struct
+{
+    int count; // Number of lines
+    size_t* offsets; // Start of each line in the message
+    size_t* lengths; // Length of each line
+    int capacity; // Allocated entries in offsets/lengths (reused across parses)
+} chunk_view_t;
+
+// Accumulates lines and produces a chunk message
+typedef struct
+{
+    char* data; // Lines back to back
+    size_t len;
+    size_t cap;
+    size_t* lengths; // Length of each line
+    int count;
+    int lines_cap;
+} chunk_builder_t;
+
+/**
+* Quick check before parsing
+* @param msg Message
+* @return 1 if msg starts with CHUNK_MARKER
+*/
+static inline int chunk_is_candidate(const char* msg)
+{
+    return msg[0] == CHUNK_MARKER;
+}
+
+/**
+* Parse a chunk message into its offsets table
+* @param msg Message ('\0' terminated)
+* @param msg_len Length of msg
+* @param view Filled with the lines (its arrays are grown as needed)
+* @return 0 if msg is a well formed chunk, -1 otherwise
+*/
+int chunk_parse(const char* msg, size_t msg_len, chunk_view_t* view);
+
+/**
+* Release the view's arrays
+* @param view Pointer to view
+*/
+void chunk_view_destroy(chunk_view_t* view);
+
+/**
+* Add a line to the chunk being built
+* @param builder Pointer to builder (zero initialized before first use)
+* @param line Line bytes (must not contain '\0')
+* @param len Length of the line
+* @return 0 on success, -1 on allocation failure
+*/
+int chunk_builder_add(chunk_builder_t* builder, const char* line, size_t len);
+
+/**
+* Produce the chunk message for the lines added so far and reset the builder
+* @param builder Pointer to builder
+* @param msg_len Set to the length of the message
+* @return Newly allocated '\0' terminated message (caller frees), NULL on failure
+*/
+char* chunk_builder_finish(chunk_builder_t* builder, size_t* msg_len);
+
+/**
+* Release the builder's buffers
+* @param builder Pointer to builder
+*/
+void chunk_builder_destroy(chunk_builder_t* builder);
+
+#endif // CHUNK_H
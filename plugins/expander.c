@@ -2,28 +2,67 @@
 
 #include "plugin_common.h"
 #include "plugin_sdk.h"
+#include "text/utf8.h"
 #include <string.h>
 #include <stdlib.h>
 
+static int text_mode = UTF8_MODE_CODEPOINTS;
+
+// Byte kernel - also the fast path for pure ASCII input
+static void expand_bytes(const char* input, size_t len_word, char* result) {
+    for (size_t i = 0; i < len_word; ++i) {
+        result[i*2] = input[i];
+        result[i*2+1] = ' ';  
+    }
+}
+
+// Codepoint kernel - ASCII runs use the byte interleave,
+// multibyte sequences are copied whole before their space
+static void expand_codepoints(const char* input, size_t len_word, char* result) {
+    size_t i = 0;
+    char* out = result;
+    while (i < len_word) {
+        size_t run = utf8_ascii_prefix(input + i, len_word - i);
+        expand_bytes(input + i, run, out);
+        out += run * 2;
+        i += run;
+        if (i >= len_word) break;
+
+        size_t k = utf8_char_len((unsigned char)input[i]);
+        memcpy(out, input + i, k);
+        out[k] = ' ';
+        out += k + 1;
+        i += k;
+    }
+}
+
 // Plugin logic
-static const char* plugin_transform(const char* input) {
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
     if (input == NULL) return NULL;
 
     size_t len_word = strlen(input);
-    size_t len_spaces = len_word-1;
 
     // Edge casempty or single character string doesn't need expanding
     if (len_word <= 1) {
         return strdup(input);
     }
 
+    // Pure ASCII (the common case) and invalid UTF-8 both take the byte kernel
+    size_t ascii = (text_mode == UTF8_MODE_CODEPOINTS) ? utf8_ascii_prefix(input, len_word) : len_word;
+    int codepoints = (ascii != len_word && utf8_validate(input + ascii, len_word - ascii));
+
+    // One space between every two characters
+    size_t len_chars = codepoints ? utf8_count_codepoints(input, len_word) : len_word;
+    size_t len_spaces = len_chars - 1;
+
     char* result = malloc(len_word + len_spaces + 1); 
     if (!result) return NULL;
 
-   
-    for (size_t i = 0; i < len_word; ++i) {
-        result[i*2] = input[i];
-        result[i*2+1] = ' ';  
+    if (codepoints) {
+        expand_codepoints(input, len_word, result);
+    } else {
+        expand_bytes(input, len_word, result);
     }
 
     result[len_spaces + len_word] = '\0';  // null terminate
@@ -32,7 +71,11 @@ static const char* plugin_transform(const char* input) {
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "expander", queue_size);
+    text_mode = utf8_mode_from_env();
+    if (text_mode < 0) {
+        return "invalid " UTF8_MODE_ENV;
+    }
+    return common_plugin_init_ex(plugin_transform, "expander", queue_size, PLUGIN_FLAG_PURE);
 }
 
 __attribute__((visibility("default")))
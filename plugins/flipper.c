@@ -2,11 +2,40 @@
 
 #include "plugin_common.h"
 #include "plugin_sdk.h"
+#include "text/utf8.h"
 #include <string.h>
 #include <stdlib.h>
 
+static int text_mode = UTF8_MODE_CODEPOINTS;
+
+// Byte kernel - also the fast path for pure ASCII input
+static void flip_bytes(const char* input, size_t len, char* result) {
+    for (size_t i = 0; i < len; ++i) {
+        result[i] = input[len-1-i];
+    }
+}
+
+// Codepoint kernel - ASCII runs are still flipped byte by byte,
+// only multibyte sequences are copied whole to their mirrored slot
+static void flip_codepoints(const char* input, size_t len, char* result) {
+    size_t i = 0;
+    while (i < len) {
+        size_t run = utf8_ascii_prefix(input + i, len - i);
+        for (size_t j = 0; j < run; ++j) {
+            result[len-1-(i+j)] = input[i+j];
+        }
+        i += run;
+        if (i >= len) break;
+
+        size_t k = utf8_char_len((unsigned char)input[i]);
+        memcpy(result + len - i - k, input + i, k);
+        i += k;
+    }
+}
+
 // Plugin logic
-static const char* plugin_transform(const char* input) {
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
     if (input == NULL) return NULL;
 
     size_t len = strlen(input);
@@ -19,9 +48,12 @@ static const char* plugin_transform(const char* input) {
     char* result = malloc(len + 1); 
     if (!result) return NULL;
 
-   
-    for (size_t i = 0; i < len; ++i) {
-        result[i] = input[len-1-i];
+    // Pure ASCII (the common case) and invalid UTF-8 both take the byte kernel
+    size_t ascii = (text_mode == UTF8_MODE_CODEPOINTS) ? utf8_ascii_prefix(input, len) : len;
+    if (ascii != len && utf8_validate(input + ascii, len - ascii)) {
+        flip_codepoints(input, len, result);
+    } else {
+        flip_bytes(input, len, result);
     }
 
     result[len] = '\0';  // null terminate
@@ -30,7 +62,11 @@ static const char* plugin_transform(const char* input) {
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "flipper", queue_size);
+    text_mode = utf8_mode_from_env();
+    if (text_mode < 0) {
+        return "invalid " UTF8_MODE_ENV;
+    }
+    return common_plugin_init_ex(plugin_transform, "flipper", queue_size, PLUGIN_FLAG_PURE);
 }
 
 __attribute__((visibility("default")))
@@ -39,4 +75,3 @@ const char* plugin_get_name(void) {
 }
 
 
-
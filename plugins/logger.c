@@ -2,23 +2,73 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "plugin_common.h"
 #include "plugin_sdk.h"
+#include "../io/block_writer.h"
 
 
+// With ANALYZER_IO_ENGINE=uring lines are batched into large io_uring writes
+// instead of one fprintf + fflush each; the batch goes out whenever the queue
+// runs dry, so output still keeps up with interactive input
+static block_writer_t writer;
+static int batched = 0;
+
+static void logger_flush(void) {
+    if (!batched) return;
+    block_writer_destroy(&writer);
+    batched = 0;
+}
+
 //Plugin logic
-static const char* plugin_transform(const char* input) {
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
     if (input == NULL) return NULL;
-    fprintf(stdout, "[logger] %s\n", input);
-    fflush(stdout);
+
+    if (!batched) {
+        fprintf(stdout, "[logger] %s\n", input);
+        fflush(stdout);
+        return strdup(input);
+    }
+
+    static const char prefix[] = "[logger] ";
+    block_writer_append(&writer, prefix, sizeof(prefix) - 1);
+    block_writer_append(&writer, input, strlen(input));
+    block_writer_append(&writer, "\n", 1);
+    if (common_plugin_pending() == 0) {
+        block_writer_kick(&writer);
+    }
     return strdup(input); 
 }
 
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "logger", queue_size);
-}
+    int engine = uring_engine_requested();
+    if (engine < 0) {
+        return "invalid " IO_ENGINE_ENV;
+    }
+
+    // Anything printed through stdio before us must come first
+    fflush(stdout);
+    if (engine == 1 && block_writer_init(&writer, STDOUT_FILENO, 0, 1) == 0) {
+        batched = 1;
+    }
 
+    const char* error = common_plugin_init(plugin_transform, "logger", queue_size);
+    if (error != NULL) {
+        logger_flush();
+        return error;
+    }
 
+    // Only the uring writer buffers outside the stage; a sync logger can be hot-swapped
+    if (batched) {
+        common_plugin_set_fini_hook(logger_flush);
+    }
+    return NULL;
+}
 
+__attribute__((visibility("default")))
+const char* plugin_get_name(void) {
+    return "logger";
+}
@@ -1,11 +1,125 @@
 #include "plugin_common.h"
+#include "stats/probes.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 
 
-static plugin_context_t* context = NULL;
 
+// Run the plugin's transform, answering repeated inputs from the cache when there is one
+static const char* run_transform(plugin_context_t* context, const char* item)
+{
+    if (!context->cache) {
+        return context->process_function(item);
+    }
+
+    size_t len = strlen(item);
+    uint64_t hash = transform_cache_hash(item, len);
+    size_t out_len = 0;
+    const char* cached = transform_cache_lookup(context->cache, hash, item, len, &out_len);
+    if (cached) {
+        // The caller frees what we return, so hand out a copy
+        char* copy = malloc(out_len + 1);
+        if (copy) {
+            memcpy(copy, cached, out_len + 1);
+        }
+        return copy;
+    }
+
+    const char* out = context->process_function(item);
+    if (out && out != item) {
+        transform_cache_insert(context->cache, hash, item, len, out, strlen(out));
+    }
+    return out;
+}
+
+// Budget from PLUGIN_CACHE_BYTES_<NAME>, else PLUGIN_CACHE_BYTES, 0 if neither is set
+// A value that is not a byte count is reported and treated as 0 (no cache)
+static size_t cache_budget_from_env(const char* name)
+{
+    char key[128];
+    size_t prefix = strlen(PLUGIN_CACHE_BYTES_ENV);
+    snprintf(key, sizeof(key), "%s_%s", PLUGIN_CACHE_BYTES_ENV, name);
+    for (size_t i = prefix + 1; key[i] != '\0'; ++i) {
+        key[i] = (char)toupper((unsigned char)key[i]);
+    }
+
+    const char* value = getenv(key);
+    const char* source = key;
+    if (value == NULL || *value == '\0') {
+        value = getenv(PLUGIN_CACHE_BYTES_ENV);
+        source = PLUGIN_CACHE_BYTES_ENV;
+    }
+    if (value == NULL || *value == '\0') {
+        return 0;
+    }
+
+    char* end = NULL;
+    errno = 0;
+    unsigned long long budget = strtoull(value, &end, 10);
+    if (errno != 0 || *end != '\0' || value[0] == '-' || budget > SIZE_MAX) {
+        fprintf(stderr, "[WARNING][%s] - invalid %s '%s', cache disabled\n", name, source, value);
+        return 0;
+    }
+    return (size_t)budget;
+}
+
+
+// Run the transform over every line of a parsed chunk (context->chunk_in) and
+// pack the results into one chunk. Lines are '\0' terminated in place (item is
+// our own copy) so nothing is copied on the way in; a line whose transform
+// fails is dropped, like a failed single item
+// Returns the new chunk, NULL if no line survived
+static char* run_chunk(plugin_context_t* context, char* item)
+{
+    chunk_view_t* view = &context->chunk_in;
+    for (int i = 0; i < view->count; ++i) {
+        char* line = item + view->offsets[i];
+        char saved = line[view->lengths[i]];
+        line[view->lengths[i]] = '\0';
+        const char* out = run_transform(context, line);
+        line[view->lengths[i]] = saved;
+
+        if (out == NULL) {
+            stage_counter_add(&context->stats.errors, 1);
+            continue;
+        }
+        chunk_builder_add(&context->chunk_out, out, strlen(out));
+        if (out != line) {
+            free((char*)out);
+        }
+    }
+
+    stage_counter_add(&context->stats.items_in, (uint64_t)view->count);
+    stage_counter_add(&context->stats.items_out, (uint64_t)context->chunk_out.count);
+    if (context->chunk_out.count == 0) {
+        return NULL;
+    }
+    size_t out_len = 0;
+    return chunk_builder_finish(&context->chunk_out, &out_len);
+}
+
+// Timestamps come from different threads; never let a tiny skew wrap around
+static uint64_t elapsed_between(uint64_t from_ns, uint64_t to_ns)
+{
+    return to_ns > from_ns ? to_ns - from_ns : 0;
+}
+
+// Keep a traced item's spans in this stage (--trace)
+static void record_trace(plugin_context_t* context, const queue_item_meta_t* meta, uint64_t start_ns, uint64_t end_ns)
+{
+    if (context->trace == NULL) {
+        context->trace = trace_track_open(context->name);
+        if (context->trace == NULL) {
+            return;
+        }
+    }
+    trace_event_t event = { meta->trace_id, meta->enqueue_ns, start_ns, end_ns };
+    trace_record(context->trace, &event);
+}
 
 // An entry function to thread that processes items from the queue
 void* plugin_consumer_thread(void* arg)
@@ -21,7 +135,8 @@ void* plugin_consumer_thread(void* arg)
     }
 
     while (1) {
-        char* item = consumer_producer_get(context->queue);
+        queue_item_meta_t meta;
+        char* item = consumer_producer_get_meta(context->queue, &meta);
         if (!item) continue;
 
         int is_end = (strcmp(item, "<END>") == 0);
@@ -29,29 +144,58 @@ void* plugin_consumer_thread(void* arg)
         if (is_end) {
             if (context->next_place_work) {
                 context->next_place_work(item);
-            } else {
-                free(item);
             }
+            free(item);
             break;
         }
 
-        // Process the item
-        const char* out = context->process_function(item);
-        
-        if (context->next_place_work) {
-        // Not the last plugin - > pass output to next
-        context->next_place_work(out);
-        if (out != item) {
-            free(item);
-        }
+        // Process the item - a chunk is transformed line by line and stays one message
+        // (a hot swap waits for this, so one item never sees two transforms)
+        const char* out;
+        int forward = 1;
+        size_t item_len = strlen(item);
+        uint64_t process_start = stage_stats_now_ns();
+        // Only items placed as chunks are parsed - a line may start with the marker too
+        int is_chunk = (meta.flags & QUEUE_ITEM_CHUNK) && chunk_parse(item, item_len, &context->chunk_in) == 0;
+        // What this item turns into is as old as the item itself, and a chunk again if it was one
+        consumer_producer_set_thread_origin(meta.ingest_ns, meta.trace_id, is_chunk ? QUEUE_ITEM_CHUNK : 0);
+        ANALYZER_PROBE3(process_entry, context->name, item, item_len);
+        pthread_mutex_lock(&context->swap_mutex);
+        if (is_chunk) {
+            out = run_chunk(context, item);
+            forward = (out != NULL);
         } else {
-            // Last plugin → no printing, just cleanup
-            if (out != item) {
-                free((char*)out);
-            }
-            free(item);
+            out = run_transform(context, item);
+            forward = (out != NULL); // Nothing to pass on - never hand NULL to the next stage
+            stage_counter_add(&context->stats.items_in, 1);
+            stage_counter_add(&context->stats.items_out, out != NULL);
+            stage_counter_add(&context->stats.errors, out == NULL);
         }
+        pthread_mutex_unlock(&context->swap_mutex);
+        ANALYZER_PROBE2(process_return, context->name, forward ? out : NULL);
+        uint64_t process_end = stage_stats_now_ns();
+        stage_counter_add(&context->stats.process_ns, process_end - process_start);
+        latency_histogram_record(&context->latency.queue, elapsed_between(meta.enqueue_ns, process_start));
+        latency_histogram_record(&context->latency.service, process_end - process_start);
+        latency_histogram_record(&context->latency.since_ingest, elapsed_between(meta.ingest_ns, process_end));
+        if (meta.trace_id != 0) {
+            record_trace(context, &meta, process_start, process_end);
+        }
+        stage_counter_add(&context->stats.bytes_in, item_len);
+        if (forward) {
+            stage_counter_add(&context->stats.bytes_out, strlen(out));
+        }
+        
+        if (forward && context->next_place_work) {
+            // Not the last plugin - > pass output to next (its queue keeps its own copy)
+            context->next_place_work(out);
+        }
+        // Either way this thread still owns item and out
+        if (out != item) {
+            free((char*)out);
         }
+        free(item);
+    }
 
     context->finished = 1;
     consumer_producer_signal_finished(context->queue);
@@ -94,11 +238,10 @@ void log_info(plugin_context_t* ctx, const char* message)
 
 
 
-__attribute__((visibility("default")))
-const char* common_plugin_init(const char *(*process_function)(const char *), const char *name, int queue_size)
+const char* plugin_runtime_init(plugin_context_t** slot, const char *(*process_function)(const char *), const char *name, int queue_size, int flags)
 {
-    // allocate memory for this instance's context - JUST TRYING
-    context = malloc(sizeof(plugin_context_t));
+    // allocate memory for this instance's context
+    plugin_context_t* context = malloc(sizeof(plugin_context_t));
     if (!context) {
         fprintf(stderr, "[ERROR] Failed to allocate plugin context\n");
         return "Failed to allocate plugin context";
@@ -108,18 +251,17 @@ const char* common_plugin_init(const char *(*process_function)(const char *), co
     memset(context, 0, sizeof(plugin_context_t)); // Clear the allocated memory
     context->name = name;
     context->process_function = process_function;
+    context->flags = flags;
 
     if (!process_function) {
         log_error(context, "common_plugin_init: process_function is NULL");
         free(context);
-        context = NULL;
         return "process_function is NULL";
     }
 
     if (!name) {
         log_error(context, "common_plugin_init: plugin name is NULL");
         free(context);
-        context = NULL;
         return "plugin name is NULL";
     }
 
@@ -127,7 +269,6 @@ const char* common_plugin_init(const char *(*process_function)(const char *), co
     if (queue_size <= 0) {
         log_error(context, "common_plugin_init: queue_size must be > 0");
         free(context);
-        context = NULL;
         return "queue_size must be > 0";
     }
 
@@ -136,7 +277,6 @@ const char* common_plugin_init(const char *(*process_function)(const char *), co
     if (!context->queue) {
         log_error(context, "malloc(queue) failed");
         free(context);
-        context = NULL;
         return "malloc failed";
     }
 
@@ -146,30 +286,82 @@ const char* common_plugin_init(const char *(*process_function)(const char *), co
         consumer_producer_destroy(context->queue);
         free(context->queue);
         free(context);
-        context = NULL;
         return "queue init failed";
     }
 
-    //Startnig consumer thread
-    if (pthread_create(&context->consumer_thread, NULL, plugin_consumer_thread, context) != 0) {
-        log_error(context, "pthread_create failed");
-        consumer_producer_destroy(context->queue);
-        free(context->queue);
-        free(context);
-        context = NULL;
-        return "pthread_create failed";
+    // Result cache is opt-in, and only for plugins that declared themselves pure
+    size_t cache_budget = (flags & PLUGIN_FLAG_PURE) ? cache_budget_from_env(name) : 0;
+    if (cache_budget > 0) {
+        context->cache = malloc(sizeof(*context->cache));
+        if (!context->cache || transform_cache_init(context->cache, cache_budget) != 0) {
+            log_error(context, "transform cache init failed");
+            free(context->cache);
+            consumer_producer_destroy(context->queue);
+            free(context->queue);
+            free(context);
+            return "cache init failed";
+        }
     }
 
-
-    //finial initialization
+    // The consumer thread is started by the first place_work, so stages that are
+    // set up but never (or only much later) fed cost no thread during startup
+    pthread_mutex_init(&context->start_mutex, NULL);
+    pthread_mutex_init(&context->swap_mutex, NULL);
     context->initialized = 1;
+    *slot = context;
+
     //log_info(context, "Plugin initialized successfully");
     return NULL;
 }
 
 
-__attribute__((visibility("default")))
-const char* plugin_fini(void) {
+// Start the consumer thread if this is the first work placed
+static const char* ensure_consumer_started(plugin_context_t* context)
+{
+    if (__atomic_load_n(&context->thread_started, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    const char* error = NULL;
+    pthread_mutex_lock(&context->start_mutex);
+    if (!context->thread_started) {
+        if (pthread_create(&context->consumer_thread, NULL, plugin_consumer_thread, context) != 0) {
+            log_error(context, "pthread_create failed");
+            error = "pthread_create failed";
+        } else {
+            __atomic_store_n(&context->thread_started, 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&context->start_mutex);
+    return error;
+}
+
+
+void plugin_runtime_set_fini_hook(plugin_context_t* context, void (*fini_hook)(void))
+{
+    if (!context) {
+        fprintf(stderr, "[ERROR] Cannot set fini hook: plugin not initialized\n");
+        return;
+    }
+    context->fini_hook = fini_hook;
+}
+
+
+int plugin_runtime_pending(plugin_context_t* context)
+{
+    if (!context || !context->queue) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&context->queue->shared_mutex);
+    int count = context->queue->count;
+    pthread_mutex_unlock(&context->queue->shared_mutex);
+    return count;
+}
+
+
+const char* plugin_runtime_fini(plugin_context_t** slot) {
+    plugin_context_t* context = *slot;
     if (context == NULL) {
         return "Plugin context is NULL";
     }
@@ -178,24 +370,44 @@ const char* plugin_fini(void) {
         return "Plugin not initialized";
     }
     
-    consumer_producer_put(context->queue, "<END>");
-    
-    int res = pthread_join(context->consumer_thread, NULL);
-    if (res != 0) {
-        log_error(context, "Failed to join plugin thread");
-        return "Failed to join plugin thread";
+    // A stage that never got any work has no thread to stop
+    if (context->thread_started) {
+        consumer_producer_put(context->queue, "<END>");
+
+        int res = pthread_join(context->consumer_thread, NULL);
+        if (res != 0) {
+            log_error(context, "Failed to join plugin thread");
+            return "Failed to join plugin thread";
+        }
+    }
+
+    if (context->fini_hook) {
+        context->fini_hook();
+    }
+
+    if (context->cache) {
+        char message[160];
+        snprintf(message, sizeof(message), "cache: %llu hits, %llu misses, %llu evictions, %zu bytes held",
+                 (unsigned long long)context->cache->hits, (unsigned long long)context->cache->misses,
+                 (unsigned long long)context->cache->evictions, context->cache->used);
+        log_info(context, message);
+        transform_cache_destroy(context->cache);
+        free(context->cache);
     }
     
+    chunk_view_destroy(&context->chunk_in);
+    chunk_builder_destroy(&context->chunk_out);
+    pthread_mutex_destroy(&context->start_mutex);
+    pthread_mutex_destroy(&context->swap_mutex);
     consumer_producer_destroy(context->queue);
     free(context->queue);
     free(context);
-    context = NULL;
+    *slot = NULL;
     
     return NULL;
 }
 
-__attribute__((visibility("default")))
-const char* plugin_place_work(const char* str)
+const char* plugin_runtime_place_work(plugin_context_t* context, const char* str)
 {
     if (context == NULL) {
         log_error(context, "plugin_place_work called before initialization.");
@@ -211,6 +423,11 @@ const char* plugin_place_work(const char* str)
         return NULL;
     }
 
+    const char* error = ensure_consumer_started(context);
+    if (error != NULL) {
+        return error;
+    }
+
     int result = consumer_producer_put(context->queue, str);
     if (result != 0) {
         log_error(context, "Failed to put item in queue.");
@@ -221,8 +438,115 @@ const char* plugin_place_work(const char* str)
     return NULL;
 }
 
-__attribute__((visibility("default")))
-void plugin_attach(const char* (*next_place_work)(const char*))
+const char* plugin_runtime_place_work_n(plugin_context_t* context, const char* str, size_t len)
+{
+    if (context == NULL) {
+        log_error(context, "plugin_place_work_n called before initialization.");
+        return "Plugin not initialized";
+    }
+    if (!context->queue) {
+        log_error(context, "plugin_place_work_n called with NULL queue.");
+        return "Queue not initialized";
+    }
+
+    if (str == NULL) {
+        log_error(context, "plugin_place_work_n received NULL string.");
+        return NULL;
+    }
+
+    const char* error = ensure_consumer_started(context);
+    if (error != NULL) {
+        return error;
+    }
+
+    if (consumer_producer_put_n(context->queue, str, len) != 0) {
+        log_error(context, "Failed to put item in queue.");
+        return "Failed to put item in queue";
+    }
+    return NULL;
+}
+
+const char* plugin_runtime_swap_transform(plugin_context_t* context, const char* (*process_function)(const char*))
+{
+    if (!context || !context->initialized) {
+        fprintf(stderr, "[ERROR] plugin_swap_transform called before initialization\n");
+        return "Plugin not initialized";
+    }
+    if (!process_function) {
+        log_error(context, "plugin_swap_transform received NULL function.");
+        return "process_function is NULL";
+    }
+    // A fini hook means state outside the stage (a printer thread, buffered
+    // output) that only the old build can drain, and the new build's
+    // transform would never see - switching would reorder or lose output
+    if (context->fini_hook) {
+        return "plugin keeps background state; restart the pipeline to load a new build";
+    }
+
+    // Only the item in progress is waited for; upstream keeps filling the queue meanwhile
+    pthread_mutex_lock(&context->swap_mutex);
+    context->process_function = process_function;
+    if (context->cache) {
+        transform_cache_clear(context->cache);
+    }
+    pthread_mutex_unlock(&context->swap_mutex);
+    return NULL;
+}
+
+const char* plugin_runtime_get_stats(plugin_context_t* context, stage_stats_t* stats)
+{
+    if (!context || !context->initialized) {
+        return "Plugin not initialized";
+    }
+    if (!stats) {
+        return "stats is NULL";
+    }
+
+    // Counters are read while the stage runs, so the snapshot is not one instant
+    stats->items_in = stage_counter_read(&context->stats.items_in);
+    stats->bytes_in = stage_counter_read(&context->stats.bytes_in);
+    stats->items_out = stage_counter_read(&context->stats.items_out);
+    stats->bytes_out = stage_counter_read(&context->stats.bytes_out);
+    stats->errors = stage_counter_read(&context->stats.errors);
+    stats->process_ns = stage_counter_read(&context->stats.process_ns);
+    stats->get_wait_ns = stage_counter_read(&context->queue->get_wait_ns);
+    stats->put_wait_ns = stage_counter_read(&context->queue->put_wait_ns);
+    stats->cache_hits = context->cache ? stage_counter_read(&context->cache->hits) : 0;
+    stats->cache_misses = context->cache ? stage_counter_read(&context->cache->misses) : 0;
+    stats->cache_evictions = context->cache ? stage_counter_read(&context->cache->evictions) : 0;
+    return NULL;
+}
+
+const char* plugin_runtime_get_latency(plugin_context_t* context, stage_latency_t* latency)
+{
+    if (!context || !context->initialized) {
+        return "Plugin not initialized";
+    }
+    if (!latency) {
+        return "latency is NULL";
+    }
+
+    latency_histogram_snapshot(&latency->queue, &context->latency.queue);
+    latency_histogram_snapshot(&latency->service, &context->latency.service);
+    latency_histogram_snapshot(&latency->since_ingest, &context->latency.since_ingest);
+    return NULL;
+}
+
+const char* plugin_runtime_get_queue_depth(plugin_context_t* context, int* count, int* capacity)
+{
+    if (!context || !context->initialized) {
+        return "Plugin not initialized";
+    }
+    if (!count || !capacity) {
+        return "count or capacity is NULL";
+    }
+
+    *count = consumer_producer_count(context->queue);
+    *capacity = context->queue->capacity;
+    return NULL;
+}
+
+void plugin_runtime_attach(plugin_context_t* context, const char* (*next_place_work)(const char*))
 {
     if (!context) {
         fprintf(stderr, "[ERROR] Cannot attach: plugin not initialized\n");
@@ -237,8 +561,7 @@ void plugin_attach(const char* (*next_place_work)(const char*))
     }
 }
 
-__attribute__((visibility("default")))
-const char* plugin_wait_finished(void)
+const char* plugin_runtime_wait_finished(plugin_context_t* context)
 {
     if (!context || !context->initialized) {
         fprintf(stderr, "[ERROR] plugin_wait_finished called before initialization\n");
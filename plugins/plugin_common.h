@@ -1,5 +1,17 @@
+#include "plugin_static.h"
 #include <pthread.h>
 #include "sync/consumer_producer.h"
+#include "cache/transform_cache.h"
+#include "chunk/chunk.h"
+#include "stats/stage_stats.h"
+#include "stats/latency_histogram.h"
+#include "stats/trace.h"
+
+// Flags for common_plugin_init_ex
+#define PLUGIN_FLAG_PURE 0x1 // Output depends only on the input, so results may be cached
+
+#define PLUGIN_CACHE_BYTES_ENV "PLUGIN_CACHE_BYTES" // Cache budget for every pure stage
+// PLUGIN_CACHE_BYTES_<NAME> (e.g. PLUGIN_CACHE_BYTES_FLIPPER) overrides it for one stage
 
 // Plugin context structure
 typedef struct
@@ -9,6 +21,17 @@ typedef struct
     pthread_t consumer_thread; // Consumer thread
     const char* (*next_place_work)(const char*); // Next plugin's place_work function
     const char* (*process_function)(const char*); // Plugin-specific processing function
+    void (*fini_hook)(void); // Optional plugin-specific cleanup, run by plugin_fini after the thread is joined
+    transform_cache_t* cache; // Result cache, NULL unless the plugin is pure and a budget is set
+    int flags; // PLUGIN_FLAG_* given at initialization
+    chunk_view_t chunk_in; // Offsets table of the chunk being processed
+    chunk_builder_t chunk_out; // Results of that chunk, forwarded as one chunk
+    stage_stats_t stats; // Written by the consumer thread only; queue waits live in the queue
+    stage_latency_t latency; // Recorded by the consumer thread only
+    trace_track_t* trace; // Where the consumer thread records traced items, opened on the first one
+    pthread_mutex_t start_mutex; // Serializes starting the consumer thread
+    pthread_mutex_t swap_mutex; // Held while an item is transformed - plugin_swap_transform waits on it
+    int thread_started; // Consumer thread runs - started by the first place_work, not by init
     int initialized; // Initialization flag
     int finished; // Finished processing flag
 } plugin_context_t;
@@ -51,6 +74,113 @@ const char* plugin_get_name(void);
 */
 const char* common_plugin_init(const char* (*process_function)(const char*),const char* name, int queue_size);
 
+/**
+* Same as common_plugin_init, with PLUGIN_FLAG_* flags
+* Pure plugins (PLUGIN_FLAG_PURE) get a result cache when PLUGIN_CACHE_BYTES
+* or PLUGIN_CACHE_BYTES_<NAME> is set to a byte budget
+* @param process_function Plugin-specific processing function
+* @param name Plugin name
+* @param queue_size Maximum number of items that can be queued
+* @param flags PLUGIN_FLAG_* bits
+* @return NULL in sucsess , error on failure
+*/
+const char* common_plugin_init_ex(const char* (*process_function)(const char*), const char* name, int queue_size, int flags);
+
+/**
+* Register a plugin-specific cleanup function
+* Called by plugin_fini after the consumer thread has been joined, so the
+* plugin can drain and release its own resources (threads, buffers)
+* @param fini_hook Cleanup function, NULL to clear
+*/
+void common_plugin_set_fini_hook(void (*fini_hook)(void));
+
+/**
+* Number of items waiting in this plugin's queue
+* Lets a stage that batches its output flush once it has caught up with its input
+* @return Items queued, 0 if the plugin is not initialized
+*/
+int common_plugin_pending(void);
+
+// Plugin runtime - output/libplugin_runtime.so, shared by every plugin
+// The functions below take the plugin's context explicitly; each plugin keeps
+// its context in plugin_entry.c, which turns them into the exported plugin API
+
+/**
+* Allocate and start a plugin context (backs common_plugin_init_ex)
+* @param slot Where the new context is stored
+* @param process_function Plugin-specific processing function
+* @param name Plugin name
+* @param queue_size Maximum number of items that can be queued
+* @param flags PLUGIN_FLAG_* bits
+* @return NULL in sucsess , error on failure
+*/
+const char* plugin_runtime_init(plugin_context_t** slot, const char* (*process_function)(const char*), const char* name, int queue_size, int flags);
+
+/**
+* Drain the queue, join the consumer thread and free the context (backs plugin_fini)
+* @param slot Context to finalize, set to NULL
+* @return NULL on success, error on failure
+*/
+const char* plugin_runtime_fini(plugin_context_t** slot);
+
+/**
+* plugin_place_work / plugin_place_work_n for the given context
+* @param context Plugin context
+* @return NULL on success, error on failure
+*/
+const char* plugin_runtime_place_work(plugin_context_t* context, const char* str);
+const char* plugin_runtime_place_work_n(plugin_context_t* context, const char* str, size_t len);
+
+/**
+* plugin_attach / plugin_wait_finished / plugin_swap_transform for the given context
+* @param context Plugin context
+*/
+void plugin_runtime_attach(plugin_context_t* context, const char* (*next_place_work)(const char*));
+const char* plugin_runtime_wait_finished(plugin_context_t* context);
+const char* plugin_runtime_swap_transform(plugin_context_t* context, const char* (*process_function)(const char*));
+
+/**
+* common_plugin_set_fini_hook / common_plugin_pending for the given context
+* @param context Plugin context
+*/
+void plugin_runtime_set_fini_hook(plugin_context_t* context, void (*fini_hook)(void));
+int plugin_runtime_pending(plugin_context_t* context);
+
+/**
+* plugin_get_stats for the given context
+* @param context Plugin context
+* @param stats Filled with the stage's counters
+* @return NULL on success, error on failure
+*/
+const char* plugin_runtime_get_stats(plugin_context_t* context, stage_stats_t* stats);
+
+/**
+* plugin_get_latency for the given context
+* @param context Plugin context
+* @param latency Filled with the stage's histograms
+* @return NULL on success, error on failure
+*/
+const char* plugin_runtime_get_latency(plugin_context_t* context, stage_latency_t* latency);
+
+/**
+* plugin_get_queue_depth for the given context
+* @param context Plugin context
+* @param count Set to the items waiting in the stage's queue
+* @param capacity Set to the queue's size
+* @return NULL on success, error on failure
+*/
+const char* plugin_runtime_get_queue_depth(plugin_context_t* context, int* count, int* capacity);
+
+/**
+* The plugin's own string transformation (what the consumer thread runs per item)
+* Exported so it can be driven directly, without the thread and queue (see bench/)
+* This function should be implemented by each plugin
+* @param input The string to transform
+* @return Newly allocated result (caller frees), NULL on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input);
+
 /**
 * Initialize the plugin with the specified queue size - calls
 common_plugin_init
@@ -77,6 +207,59 @@ const char* plugin_fini(void);
 __attribute__((visibility("default")))
 const char* plugin_place_work(const char* str);
 
+/**
+* Place work whose length is already known into the plugin's queue
+* Copies exactly len bytes, so str does not have to be '\0' terminated
+* @param str The bytes to process (copied)
+* @param len Number of bytes in str
+* @return 0 on success, 1 on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_place_work_n(const char* str, size_t len);
+
+
+/**
+* Replace the transform of a running plugin (hot swap)
+* Waits for the item being transformed, if any, then every later item -
+* including those already queued - goes through the new function. The
+* result cache is emptied, since it holds results of the old function
+* Refused for plugins that registered a fini hook: their own threads and
+* buffers belong to the running build
+* @param process_function New transformation, e.g. plugin_transform of a newer build
+* @return NULL on success, error on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_swap_transform(const char* (*process_function)(const char*));
+
+/**
+* Read this stage's throughput and wait-time counters
+* Safe to call from any thread while the stage runs; the counters are not
+* reset, so the difference of two calls covers the time between them
+* @param stats Filled with the counters (see stats/stage_stats.h)
+* @return NULL on success, error on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_get_stats(stage_stats_t* stats);
+
+/**
+* Copy this stage's latency histograms: time items waited in its queue, time
+* in its transform, and time since their input line entered the pipeline
+* Safe to call from any thread while the stage runs
+* @param latency Filled with the histograms (see stats/latency_histogram.h)
+* @return NULL on success, error on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_get_latency(stage_latency_t* latency);
+
+/**
+* Read how full this stage's input queue is
+* Safe to call from any thread while the stage runs (takes the queue's lock briefly)
+* @param count Set to the items waiting in the queue
+* @param capacity Set to the queue's size
+* @return NULL on success, error on failure
+*/
+__attribute__((visibility("default")))
+const char* plugin_get_queue_depth(int* count, int* capacity);
 
 /**
 * Attach this plugin to the next plugin in the chain
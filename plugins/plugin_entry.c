@@ -0,0 +1,83 @@
+#include "plugin_common.h"
+
+// The per-plugin half of the plugin API: compiled into every plugin, it owns
+// the plugin's context and forwards to the shared runtime (plugin_common.c,
+// output/libplugin_runtime.so). Exports the same symbols a plugin always had
+
+static plugin_context_t* context = NULL;
+
+
+__attribute__((visibility("default")))
+const char* common_plugin_init(const char *(*process_function)(const char *), const char *name, int queue_size)
+{
+    return common_plugin_init_ex(process_function, name, queue_size, 0);
+}
+
+const char* common_plugin_init_ex(const char *(*process_function)(const char *), const char *name, int queue_size, int flags)
+{
+    return plugin_runtime_init(&context, process_function, name, queue_size, flags);
+}
+
+void common_plugin_set_fini_hook(void (*fini_hook)(void))
+{
+    plugin_runtime_set_fini_hook(context, fini_hook);
+}
+
+int common_plugin_pending(void)
+{
+    return plugin_runtime_pending(context);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_fini(void)
+{
+    return plugin_runtime_fini(&context);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_place_work(const char* str)
+{
+    return plugin_runtime_place_work(context, str);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_place_work_n(const char* str, size_t len)
+{
+    return plugin_runtime_place_work_n(context, str, len);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_swap_transform(const char* (*process_function)(const char*))
+{
+    return plugin_runtime_swap_transform(context, process_function);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_get_stats(stage_stats_t* stats)
+{
+    return plugin_runtime_get_stats(context, stats);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_get_latency(stage_latency_t* latency)
+{
+    return plugin_runtime_get_latency(context, latency);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_get_queue_depth(int* count, int* capacity)
+{
+    return plugin_runtime_get_queue_depth(context, count, capacity);
+}
+
+__attribute__((visibility("default")))
+void plugin_attach(const char* (*next_place_work)(const char*))
+{
+    plugin_runtime_attach(context, next_place_work);
+}
+
+__attribute__((visibility("default")))
+const char* plugin_wait_finished(void)
+{
+    return plugin_runtime_wait_finished(context);
+}
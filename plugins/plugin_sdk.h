@@ -1,6 +1,10 @@
 #ifndef PLUGIN_SDK_H
 #define PLUGIN_SDK_H
 
+#include <stddef.h>
+#include "stats/stage_stats.h"
+#include "stats/latency_histogram.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,6 +21,21 @@ const char* plugin_fini(void);
 // Place work (a string) into the plugin's queue
 const char* plugin_place_work(const char* str);
 
+// Place work of known length (need not be '\0' terminated) into the plugin's queue
+const char* plugin_place_work_n(const char* str, size_t len);
+
+// Replace the transform of the running plugin (hot swap; refused once it set a fini hook)
+const char* plugin_swap_transform(const char* (*process_function)(const char*));
+
+// Read the stage's throughput and wait-time counters (any thread, any time)
+const char* plugin_get_stats(stage_stats_t* stats);
+
+// Copy the stage's queueing, service and since-ingest latency histograms
+const char* plugin_get_latency(stage_latency_t* latency);
+
+// Read how many items wait in the stage's queue, and its size
+const char* plugin_get_queue_depth(int* count, int* capacity);
+
 // Attach this plugin to the next plugin in the chain
 void plugin_attach(const char* (*next_place_work)(const char*));
 
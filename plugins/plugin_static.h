@@ -0,0 +1,40 @@
+#ifndef PLUGIN_STATIC_H
+#define PLUGIN_STATIC_H
+
+// Building a plugin into output/analyzer instead of its own .so:
+// build.sh compiles the plugin and its plugin_entry.c with
+// -DPLUGIN_STATIC_NAME=<name>, which prefixes every symbol they export
+// (plugin_init -> logger_plugin_init, ...) so several plugins link into one
+// binary, each keeping its own static context. The runtime (plugin_common.c)
+// takes the context as a parameter and is linked in once. See
+// registry/static_registry.c
+
+#ifdef PLUGIN_STATIC_NAME
+
+#define PLUGIN_STATIC_CONCAT_(prefix, symbol) prefix##_##symbol
+#define PLUGIN_STATIC_CONCAT(prefix, symbol) PLUGIN_STATIC_CONCAT_(prefix, symbol)
+#define PLUGIN_STATIC_SYMBOL(symbol) PLUGIN_STATIC_CONCAT(PLUGIN_STATIC_NAME, symbol)
+
+// Plugin API
+#define plugin_get_name PLUGIN_STATIC_SYMBOL(plugin_get_name)
+#define plugin_init PLUGIN_STATIC_SYMBOL(plugin_init)
+#define plugin_fini PLUGIN_STATIC_SYMBOL(plugin_fini)
+#define plugin_place_work PLUGIN_STATIC_SYMBOL(plugin_place_work)
+#define plugin_place_work_n PLUGIN_STATIC_SYMBOL(plugin_place_work_n)
+#define plugin_attach PLUGIN_STATIC_SYMBOL(plugin_attach)
+#define plugin_wait_finished PLUGIN_STATIC_SYMBOL(plugin_wait_finished)
+#define plugin_transform PLUGIN_STATIC_SYMBOL(plugin_transform)
+#define plugin_swap_transform PLUGIN_STATIC_SYMBOL(plugin_swap_transform)
+#define plugin_get_stats PLUGIN_STATIC_SYMBOL(plugin_get_stats)
+#define plugin_get_latency PLUGIN_STATIC_SYMBOL(plugin_get_latency)
+#define plugin_get_queue_depth PLUGIN_STATIC_SYMBOL(plugin_get_queue_depth)
+
+// plugin_entry.c, which holds the plugin's context
+#define common_plugin_init PLUGIN_STATIC_SYMBOL(common_plugin_init)
+#define common_plugin_init_ex PLUGIN_STATIC_SYMBOL(common_plugin_init_ex)
+#define common_plugin_set_fini_hook PLUGIN_STATIC_SYMBOL(common_plugin_set_fini_hook)
+#define common_plugin_pending PLUGIN_STATIC_SYMBOL(common_plugin_pending)
+
+#endif // PLUGIN_STATIC_NAME
+
+#endif // PLUGIN_STATIC_H
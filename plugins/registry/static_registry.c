@@ -0,0 +1,64 @@
+#include "static_registry.h"
+#include <string.h>
+
+// Bundled plugins compiled into the analyzer by build.sh (with
+// -DANALYZER_STATIC_PLUGINS); the list there must match this one
+#ifdef ANALYZER_STATIC_PLUGINS
+#define STATIC_PLUGIN_LIST(X) \
+    X(logger)                 \
+    X(uppercaser)             \
+    X(rotator)                \
+    X(flipper)                \
+    X(expander)               \
+    X(typewriter)
+#else
+#define STATIC_PLUGIN_LIST(X)
+#endif
+
+// The prefixed symbols plugin_static.h gives each plugin
+#define STATIC_PLUGIN_DECLARE(name)                                           \
+    const char* name##_plugin_init(int queue_size);                          \
+    const char* name##_plugin_fini(void);                                    \
+    const char* name##_plugin_place_work(const char* str);                   \
+    const char* name##_plugin_place_work_n(const char* str, size_t len);     \
+    void name##_plugin_attach(const char* (*next_place_work)(const char*));  \
+    const char* name##_plugin_wait_finished(void);                           \
+    const char* name##_plugin_transform(const char* input);                  \
+    const char* name##_plugin_swap_transform(const char* (*process_function)(const char*)); \
+    const char* name##_plugin_get_stats(stage_stats_t* stats);              \
+    const char* name##_plugin_get_latency(stage_latency_t* latency);        \
+    const char* name##_plugin_get_queue_depth(int* count, int* capacity);
+
+#define STATIC_PLUGIN_ENTRY(name)                                             \
+    {                                                                         \
+        #name,                                                                \
+        name##_plugin_init,                                                   \
+        name##_plugin_fini,                                                   \
+        name##_plugin_place_work,                                             \
+        name##_plugin_place_work_n,                                           \
+        name##_plugin_attach,                                                 \
+        name##_plugin_wait_finished,                                          \
+        name##_plugin_transform,                                              \
+        name##_plugin_swap_transform,                                         \
+        name##_plugin_get_stats,                                              \
+        name##_plugin_get_latency,                                            \
+        name##_plugin_get_queue_depth,                                        \
+    },
+
+STATIC_PLUGIN_LIST(STATIC_PLUGIN_DECLARE)
+
+static const static_plugin_t static_plugins[] = {
+    STATIC_PLUGIN_LIST(STATIC_PLUGIN_ENTRY)
+    {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL},
+};
+
+
+const static_plugin_t* static_plugin_find(const char* name)
+{
+    for (const static_plugin_t* plugin = static_plugins; plugin->name != NULL; ++plugin) {
+        if (strcmp(plugin->name, name) == 0) {
+            return plugin;
+        }
+    }
+    return NULL;
+}
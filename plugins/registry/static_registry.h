@@ -0,0 +1,34 @@
+#ifndef STATIC_REGISTRY_H
+#define STATIC_REGISTRY_H
+
+#include <stddef.h>
+#include "../stats/stage_stats.h"
+#include "../stats/latency_histogram.h"
+
+// A plugin linked into output/analyzer - same entry points as the .so exports
+typedef struct
+{
+    const char* name;
+    const char* (*init)(int);
+    const char* (*fini)(void);
+    const char* (*place_work)(const char*);
+    const char* (*place_work_n)(const char*, size_t);
+    void (*attach)(const char* (*)(const char*));
+    const char* (*wait_finished)(void);
+    const char* (*transform)(const char*);
+    const char* (*swap_transform)(const char* (*)(const char*));
+    const char* (*get_stats)(stage_stats_t*);
+    const char* (*get_latency)(stage_latency_t*);
+    const char* (*get_queue_depth)(int*, int*);
+} static_plugin_t;
+
+/**
+* Look up a plugin built into the analyzer
+* Each built-in plugin has one set of static state, so it can back only one
+* stage of a chain - further stages with the same name must be loaded from .so
+* @param name Plugin name as given on the command line
+* @return The plugin's entry points, NULL if it is not built in
+*/
+const static_plugin_t* static_plugin_find(const char* name);
+
+#endif // STATIC_REGISTRY_H
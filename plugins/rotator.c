@@ -2,13 +2,36 @@
 
 #include "plugin_common.h"  
 //#include "plugin_sdk.h"
+#include "text/utf8.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+static int text_mode = UTF8_MODE_CODEPOINTS;
+
+// Length of the last character in bytes - 1 unless the string ends
+// with a complete, well-formed multibyte sequence
+static size_t last_char_len(const char* input, size_t len) {
+    if (text_mode != UTF8_MODE_CODEPOINTS || (unsigned char)input[len - 1] < 0x80) {
+        return 1;
+    }
+
+    // Step back over at most three continuation bytes to the lead byte
+    size_t start = len - 1;
+    while (start > 0 && len - start < 4 && ((unsigned char)input[start] & 0xC0) == 0x80) {
+        start--;
+    }
+
+    size_t k = len - start;
+    if (k < 2 || utf8_char_len((unsigned char)input[start]) != k || !utf8_validate(input + start, k)) {
+        return 1; // not valid UTF-8 - rotate a single byte like before
+    }
+    return k;
+}
 
 // Plugin logic
-static const char* plugin_transform(const char* input) {
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
     if (input == NULL) return NULL;
 
     size_t len = strlen(input);
@@ -21,12 +44,12 @@ static const char* plugin_transform(const char* input) {
     char* result = malloc(len + 1); 
     if (!result) return NULL;
 
-   
-    for (size_t i = 1; i < len; ++i) {
-        result[i] = input[i - 1];
-    }
+    // Only the last character moves, so only it needs to be decoded -
+    // everything before it is shifted as one block
+    size_t k = last_char_len(input, len);
+    memcpy(result, input + len - k, k);
+    memcpy(result + k, input, len - k);
 
-    result[0] = input[len - 1];
     result[len] = '\0';  // null terminate
     return result;       // plugin_common will free it
 }
@@ -34,7 +57,11 @@ static const char* plugin_transform(const char* input) {
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "rotator", queue_size);
+    text_mode = utf8_mode_from_env();
+    if (text_mode < 0) {
+        return "invalid " UTF8_MODE_ENV;
+    }
+    return common_plugin_init_ex(plugin_transform, "rotator", queue_size, PLUGIN_FLAG_PURE);
 }
 
 
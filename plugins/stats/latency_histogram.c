@@ -0,0 +1,89 @@
+#include "latency_histogram.h"
+#include "stage_stats.h"
+#include <string.h>
+
+
+static int bucket_of(uint64_t value)
+{
+    if (value < (1u << LATENCY_SUB_BITS)) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (LATENCY_SUB_BITS - 1);
+    return shift * LATENCY_HALF_BUCKETS + (int)(value >> shift);
+}
+
+// Largest value that falls into bucket
+static uint64_t bucket_high(int bucket)
+{
+    if (bucket < (1 << LATENCY_SUB_BITS)) {
+        return (uint64_t)bucket;
+    }
+    int shift = bucket / LATENCY_HALF_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(bucket % LATENCY_HALF_BUCKETS + LATENCY_HALF_BUCKETS);
+    return ((sub + 1) << shift) - 1;
+}
+
+void latency_histogram_record(latency_histogram_t* histogram, uint64_t value_ns)
+{
+    stage_counter_add(&histogram->counts[bucket_of(value_ns)], 1);
+    stage_counter_add(&histogram->total, 1);
+    if (value_ns > histogram->max) {
+        __atomic_store_n(&histogram->max, value_ns, __ATOMIC_RELAXED);
+    }
+}
+
+void latency_histogram_snapshot(latency_histogram_t* to, const latency_histogram_t* from)
+{
+    // The total is rebuilt from the buckets, so it always matches them
+    to->total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        to->counts[i] = stage_counter_read(&from->counts[i]);
+        to->total += to->counts[i];
+    }
+    to->max = stage_counter_read(&from->max);
+}
+
+uint64_t latency_histogram_count_at_most(const latency_histogram_t* histogram, uint64_t bound_ns)
+{
+    int last = bucket_of(bound_ns);
+    uint64_t count = 0;
+    for (int i = 0; i <= last; ++i) {
+        count += histogram->counts[i];
+    }
+    return count;
+}
+
+double latency_histogram_sum(const latency_histogram_t* histogram)
+{
+    double sum = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        if (histogram->counts[i] == 0) continue;
+        uint64_t low = i == 0 ? 0 : bucket_high(i - 1) + 1;
+        sum += (double)histogram->counts[i] * ((double)low + (double)bucket_high(i)) / 2.0;
+    }
+    return sum;
+}
+
+uint64_t latency_histogram_percentile(const latency_histogram_t* histogram, double percentile)
+{
+    if (histogram->total == 0) {
+        return 0;
+    }
+
+    // Rank of the value we want, 1 based: the smallest value with at least
+    // percentile% of the values at or below it
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > histogram->total) rank = histogram->total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t high = bucket_high(i);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
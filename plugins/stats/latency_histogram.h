@@ -0,0 +1,75 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+// Log-linear (HDR style) histogram of nanosecond values: values below
+// 2^LATENCY_SUB_BITS get a bucket each, and every power of two above that is
+// split into LATENCY_HALF_BUCKETS equal buckets, so any recorded value is known
+// to within 1/32 (about 3%) from 1 ns to centuries in a fixed 15 KB
+#define LATENCY_SUB_BITS 6
+#define LATENCY_HALF_BUCKETS (1 << (LATENCY_SUB_BITS - 1))
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) * LATENCY_HALF_BUCKETS + LATENCY_HALF_BUCKETS)
+
+typedef struct
+{
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total; // Values recorded
+    uint64_t max; // Largest value recorded (exact)
+} latency_histogram_t;
+
+// The latency histograms of one stage, as returned by plugin_get_latency
+// An item's ingest time is when its input line was read, before any wait for
+// room in the first stage's queue (a chunk: when its first line was read);
+// at the last stage, since_ingest is the pipeline's end-to-end latency
+typedef struct
+{
+    latency_histogram_t queue; // Enqueue to dequeue in the stage's queue
+    latency_histogram_t service; // Inside process_function
+    latency_histogram_t since_ingest; // Ingest to the stage's result being ready
+} stage_latency_t;
+
+/**
+* Record one value
+* Only one thread may record into a histogram; any thread may read it meanwhile
+* (latency_histogram_snapshot) and sees each bucket either before or after
+* @param histogram Histogram (zero initialized)
+* @param value_ns Value to record
+*/
+void latency_histogram_record(latency_histogram_t* histogram, uint64_t value_ns);
+
+/**
+* Copy a histogram that may be recorded into concurrently
+* @param to Destination
+* @param from Source
+*/
+void latency_histogram_snapshot(latency_histogram_t* to, const latency_histogram_t* from);
+
+/**
+* Value at a percentile
+* @param histogram Histogram (not recorded into meanwhile - use a snapshot)
+* @param percentile 0 to 100, e.g. 99.9
+* @return Highest value of the bucket holding the percentile (at most the
+*         recorded max), 0 if the histogram is empty
+*/
+uint64_t latency_histogram_percentile(const latency_histogram_t* histogram, double percentile);
+
+/**
+* Number of values at or below a bound (cumulative count, as in a Prometheus
+* histogram's le buckets)
+* The bucket holding the bound counts whole, so values up to 1/32 above it may
+* be included
+* @param histogram Histogram (not recorded into meanwhile - use a snapshot)
+* @param bound_ns Upper bound
+* @return Count of values recorded at or below bound_ns
+*/
+uint64_t latency_histogram_count_at_most(const latency_histogram_t* histogram, uint64_t bound_ns);
+
+/**
+* Sum of the recorded values, each taken as the middle of its bucket
+* @param histogram Histogram (not recorded into meanwhile - use a snapshot)
+* @return Estimated sum in nanoseconds, within 1/64 of the true sum
+*/
+double latency_histogram_sum(const latency_histogram_t* histogram);
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,37 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// Static tracepoints (USDT/SDT) of the plugin runtime, provider "analyzer"
+// A probe is a single nop plus an ELF note until perf, bpftrace or SystemTap
+// attaches to it, so they stay in release builds. Built without sys/sdt.h
+// (systemtap-sdt-dev), they compile to nothing but still evaluate their
+// arguments (which have no side effects). All probes live in
+// output/libplugin_runtime.so:
+//
+//   queue_put_entry(queue, len)           consumer_producer_put called - before the copy
+//   queue_put_return(queue, count)        item stored; count is the queue's new fill
+//   queue_get_entry(queue)                consumer_producer_get - before taking the lock
+//   queue_get_return(queue, item, count)  item taken (NULL once the queue finished)
+//   monitor_wait_entry(monitor)           about to block on a full or empty queue
+//   monitor_wait_return(monitor, rc)      woken up
+//   process_entry(name, item, len)        a stage's thread starts on an item
+//   process_return(name, out)             its transform is done (out NULL if dropped)
+//
+// e.g. time producers spend in put (copying the item, taking the lock and
+// waiting for room), per queue:
+//   bpftrace -e 'usdt:output/libplugin_runtime.so:analyzer:queue_put_entry { @s[tid] = nsecs; }
+//                usdt:output/libplugin_runtime.so:analyzer:queue_put_return /@s[tid]/ {
+//                    @put_ns[arg0] = hist(nsecs - @s[tid]); delete(@s[tid]); }' -p <pid>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define ANALYZER_PROBE1(name, a1) STAP_PROBE1(analyzer, name, a1)
+#define ANALYZER_PROBE2(name, a1, a2) STAP_PROBE2(analyzer, name, a1, a2)
+#define ANALYZER_PROBE3(name, a1, a2, a3) STAP_PROBE3(analyzer, name, a1, a2, a3)
+#else
+#define ANALYZER_PROBE1(name, a1) ((void)(a1))
+#define ANALYZER_PROBE2(name, a1, a2) ((void)(a1), (void)(a2))
+#define ANALYZER_PROBE3(name, a1, a2, a3) ((void)(a1), (void)(a2), (void)(a3))
+#endif
+
+#endif // PROBES_H
@@ -0,0 +1,58 @@
+#ifndef STAGE_STATS_H
+#define STAGE_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+// What one stage has done so far, as returned by plugin_get_stats
+// Lines of a chunk count one by one; bytes are whole queue messages
+typedef struct
+{
+    uint64_t items_in; // Lines taken from the stage's queue
+    uint64_t bytes_in;
+    uint64_t items_out; // Lines the transform produced (forwarded, or final at the last stage)
+    uint64_t bytes_out;
+    uint64_t errors; // Lines the transform returned NULL for (dropped, not forwarded)
+    uint64_t process_ns; // Time inside process_function
+    uint64_t get_wait_ns; // Time the stage's thread waited for input (its queue empty)
+    uint64_t put_wait_ns; // Time producers waited to hand it work (its queue full) -
+                          // for the stage before it, that is time blocked downstream
+    uint64_t cache_hits; // Result cache counters, 0 when the stage has no cache
+    uint64_t cache_misses;
+    uint64_t cache_evictions;
+} stage_stats_t;
+
+/**
+* Add to a counter that other threads read while it changes
+* Only one thread may add to a given counter at a time (its owner, or
+* whoever holds the lock guarding it); readers use stage_counter_read
+* @param counter Counter to add to
+* @param value Amount to add
+*/
+static inline void stage_counter_add(uint64_t* counter, uint64_t value)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/**
+* Read a counter without stopping its writer
+* @param counter Counter to read
+* @return Its current value
+*/
+static inline uint64_t stage_counter_read(const uint64_t* counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+/**
+* Monotonic clock for the time counters
+* @return Nanoseconds since an arbitrary point
+*/
+static inline uint64_t stage_stats_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+#endif // STAGE_STATS_H
@@ -0,0 +1,188 @@
+#include "trace.h"
+#include "stage_stats.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int sample_every; // 0 while tracing is off
+static uint64_t start_ns; // Trace timestamps count from here
+static uint64_t messages; // Input messages seen by trace_sample
+
+// Tracks in the order they were opened - which is stage order, as a stage
+// only opens its track for a traced message the stage before it has passed on
+static pthread_mutex_t tracks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static trace_track_t* tracks = NULL;
+static trace_track_t** tracks_tail = &tracks;
+
+
+int trace_start(int every)
+{
+    if (every <= 0) {
+        fprintf(stderr, "Error: Trace sample rate must be positive.\n");
+        return -1;
+    }
+    start_ns = stage_stats_now_ns();
+    __atomic_store_n(&sample_every, every, __ATOMIC_RELEASE);
+    return 0;
+}
+
+uint32_t trace_sample(void)
+{
+    int every = __atomic_load_n(&sample_every, __ATOMIC_ACQUIRE);
+    if (every == 0) {
+        return 0;
+    }
+    // Several reader threads may sample at once
+    uint64_t n = __atomic_fetch_add(&messages, 1, __ATOMIC_RELAXED);
+    if (n % (uint64_t)every != 0) {
+        return 0;
+    }
+    uint32_t id = (uint32_t)(n / (uint64_t)every + 1);
+    return id != 0 ? id : 1;
+}
+
+trace_track_t* trace_track_open(const char* name)
+{
+    if (__atomic_load_n(&sample_every, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
+    }
+
+    trace_track_t* track = calloc(1, sizeof(*track));
+    if (track == NULL) {
+        return NULL;
+    }
+    track->name = strdup(name != NULL ? name : "UNKNOWN");
+    if (track->name == NULL) {
+        free(track);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&tracks_mutex);
+    *tracks_tail = track;
+    tracks_tail = &track->next;
+    pthread_mutex_unlock(&tracks_mutex);
+    return track;
+}
+
+void trace_record(trace_track_t* track, const trace_event_t* event)
+{
+    if (track->count == TRACE_MAX_EVENTS) {
+        track->dropped++;
+        return;
+    }
+    if (track->count == track->capacity) {
+        size_t capacity = track->capacity == 0 ? 1024 : track->capacity * 2;
+        if (capacity > TRACE_MAX_EVENTS) {
+            capacity = TRACE_MAX_EVENTS;
+        }
+        trace_event_t* grown = realloc(track->events, capacity * sizeof(*grown));
+        if (grown == NULL) {
+            track->dropped++;
+            return;
+        }
+        track->events = grown;
+        track->capacity = capacity;
+    }
+    track->events[track->count++] = *event;
+}
+
+// Trace-event timestamps are microseconds
+static double trace_us(uint64_t ns)
+{
+    return ns > start_ns ? (double)(ns - start_ns) / 1000.0 : 0.0;
+}
+
+static double trace_dur_us(uint64_t from_ns, uint64_t to_ns)
+{
+    return to_ns > from_ns ? (double)(to_ns - from_ns) / 1000.0 : 0.0;
+}
+
+// Plugin names are file names - keep them valid JSON whatever they hold
+static void write_json_text(FILE* out, const char* text)
+{
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+}
+
+// Name and order one track (thread row) of the timeline
+static void write_track_metadata(FILE* out, int tid, int stage, const char* name, const char* suffix)
+{
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"stage %d%s: ",
+            tid, stage, suffix);
+    write_json_text(out, name);
+    fprintf(out, "\"}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}},\n",
+            tid, tid);
+}
+
+int trace_write(const char* path)
+{
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Error: Cannot write trace '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    pthread_mutex_lock(&tracks_mutex);
+    trace_track_t* list = tracks;
+    tracks = NULL;
+    tracks_tail = &tracks;
+    pthread_mutex_unlock(&tracks_mutex);
+
+    fputs("{\"traceEvents\":[\n", out);
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"analyzer\"}},\n", out);
+
+    // Stage n gets two rows: its queue (tid 2n-1) above its thread (tid 2n)
+    // A message's spans are linked stage to stage by flow arrows on its id
+    size_t dropped = 0;
+    int stage = 0;
+    for (trace_track_t* track = list; track != NULL; track = track->next) {
+        ++stage;
+        int queue_tid = 2 * stage - 1;
+        int thread_tid = 2 * stage;
+        write_track_metadata(out, queue_tid, stage, track->name, " queue");
+        write_track_metadata(out, thread_tid, stage, track->name, "");
+
+        for (size_t i = 0; i < track->count; ++i) {
+            const trace_event_t* event = &track->events[i];
+            fprintf(out, "{\"name\":\"queued\",\"cat\":\"queue\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                         "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"msg\":%u}},\n",
+                    queue_tid, trace_us(event->enqueue_ns),
+                    trace_dur_us(event->enqueue_ns, event->start_ns), event->id);
+            fprintf(out, "{\"name\":\"process\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                         "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"msg\":%u},"
+                         "\"bind_id\":\"0x%x\",\"flow_in\":true,\"flow_out\":true},\n",
+                    thread_tid, trace_us(event->start_ns),
+                    trace_dur_us(event->start_ns, event->end_ns), event->id, event->id);
+        }
+        dropped += track->dropped;
+    }
+
+    // Closing record carries the settings, so no event needs a trailing-comma special case
+    fprintf(out, "{\"name\":\"trace_info\",\"ph\":\"M\",\"pid\":1,\"args\":{\"sample_every\":%d,\"dropped\":%zu}}\n",
+            sample_every, dropped);
+    fputs("],\"displayTimeUnit\":\"ns\"}\n", out);
+
+    while (list != NULL) {
+        trace_track_t* next = list->next;
+        free(list->events);
+        free(list->name);
+        free(list);
+        list = next;
+    }
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error: Cannot write trace '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Message flow tracing (--trace): one in every N input messages gets a trace
+// id, which rides with it through every stage like its ingest time does. Each
+// stage thread records, for traced messages only, when the message was queued,
+// dequeued and done; the analyzer writes it all out as Chrome trace-event JSON
+// (chrome://tracing, ui.perfetto.dev) at shutdown. Disabled, tracing costs one
+// load and branch per message
+
+#define TRACE_DEFAULT_SAMPLE 100 // Trace one message in this many
+#define TRACE_MAX_EVENTS 100000 // Per stage; later messages are counted but not kept
+
+// One traced message passing one stage
+typedef struct
+{
+    uint32_t id; // Trace id of the message
+    uint64_t enqueue_ns; // Put in the stage's queue
+    uint64_t start_ns; // Taken by the stage's thread
+    uint64_t end_ns; // Transform done
+} trace_event_t;
+
+// Events of one stage - written by its thread only
+typedef struct trace_track
+{
+    char* name; // Plugin name (copied - the plugin may be unloaded first)
+    trace_event_t* events;
+    size_t count;
+    size_t capacity;
+    size_t dropped; // Traced messages past TRACE_MAX_EVENTS
+    struct trace_track* next;
+} trace_track_t;
+
+/**
+* Turn tracing on - call before any input is placed
+* @param sample_every Trace one message in this many (1 = all)
+* @return 0 on success, -1 if sample_every is not positive
+*/
+int trace_start(int sample_every);
+
+/**
+* Trace id for the next input message, if it is one of the sampled ones
+* @return Non-zero id to trace the message with, 0 to leave it untraced
+*/
+uint32_t trace_sample(void);
+
+/**
+* Track a stage records into (registered on first use, kept until trace_write)
+* @param name Plugin name
+* @return Track, NULL if tracing is off or memory ran out
+*/
+trace_track_t* trace_track_open(const char* name);
+
+/**
+* Record one traced message's pass through a stage
+* @param track The stage's track
+* @param event What happened
+*/
+void trace_record(trace_track_t* track, const trace_event_t* event);
+
+/**
+* Write every track as Chrome trace-event JSON and release them
+* Call once the stages' threads are done
+* @param path File to write
+* @return 0 on success, -1 on failure
+*/
+int trace_write(const char* path);
+
+#endif // TRACE_H
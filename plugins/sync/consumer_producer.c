@@ -1,10 +1,17 @@
 #define _GNU_SOURCE
 #include "consumer_producer.h"
+#include "../stats/stage_stats.h"
+#include "../stats/probes.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 
+// Origin of what the calling thread is working on, 0 if it is a source
+static __thread uint64_t thread_ingest_ns;
+static __thread uint32_t thread_trace_id;
+static __thread uint32_t thread_flags;
+
 
 int consumer_producer_init(consumer_producer_t* queue, int capacity)
 {
@@ -19,8 +26,11 @@ int consumer_producer_init(consumer_producer_t* queue, int capacity)
     }
 
     queue->items = malloc(sizeof(char*) * capacity);
-    if (queue->items == NULL) {
+    queue->meta = malloc(sizeof(*queue->meta) * capacity);
+    if (queue->items == NULL || queue->meta == NULL) {
        fprintf(stderr, "Error: Failed to allocate memory for items array.\n");
+        free(queue->items);
+        free(queue->meta);
         return -1;
     }
 
@@ -32,37 +42,43 @@ int consumer_producer_init(consumer_producer_t* queue, int capacity)
     // Initialize monitors
     if (monitor_init(&queue->not_full_monitor) != 0) // Monitor for producers
     {
-        free(queue->items);
         fprintf(stderr, "Error: Failed to initialize not_full_monitor.\n");
-        return -1;
+        goto fail_items;
     }
 
     if (monitor_init(&queue->not_empty_monitor) != 0)
     {
-        monitor_destroy(&queue->not_full_monitor);
-        free(queue->items);
         fprintf(stderr, "Error: Failed to initialize not_empty_monitor.\n");
-        return -1;
+        goto fail_not_full;
     }
 
     if (monitor_init(&queue->finished_monitor) != 0) {
-        monitor_destroy(&queue->not_empty_monitor);
-        monitor_destroy(&queue->not_full_monitor);
-        free(queue->items);
         fprintf(stderr, "Error: Failed to initialize finished_monitor.\n");
-        return -1;
+        goto fail_not_empty;
     }
 
     if (pthread_mutex_init(&queue->shared_mutex, NULL) != 0) {
-        monitor_destroy(&queue->not_empty_monitor);
-        monitor_destroy(&queue->not_full_monitor);
-        free(queue->items);
         fprintf(stderr, "Error: Failed to initialize shared_mutex.\n");
-        return -1;
+        goto fail_finished;
     }
     queue->initialized = 1; 
     queue->finished = 0;
+    queue->put_wait_ns = 0;
+    queue->get_wait_ns = 0;
     return 0;
+
+fail_finished:
+    monitor_destroy(&queue->finished_monitor);
+fail_not_empty:
+    monitor_destroy(&queue->not_empty_monitor);
+fail_not_full:
+    monitor_destroy(&queue->not_full_monitor);
+fail_items:
+    free(queue->items);
+    free(queue->meta);
+    queue->items = NULL;
+    queue->meta = NULL;
+    return -1;
 }
 
 
@@ -88,12 +104,24 @@ void consumer_producer_destroy(consumer_producer_t* queue)
 
     // Free items array
     free(queue->items);
+    free(queue->meta);
     queue->items = NULL; 
+    queue->meta = NULL;
     queue->initialized = 0; 
 }
 
 int consumer_producer_put(consumer_producer_t* queue, const char*item)
 {
+    if (item == NULL) {
+        fprintf(stderr, "Error: consumer_producer_put received NULL item.\n");
+        return -1;
+    }
+    return consumer_producer_put_n(queue, item, strlen(item));
+}
+
+int consumer_producer_put_n(consumer_producer_t* queue, const char* item, size_t len)
+{
+    ANALYZER_PROBE2(queue_put_entry, queue, len);
     int warned = 0; // flag to track if we warned about full queue
     if (queue == NULL) {
         fprintf(stderr, "Error: consumer_producer_put received NULL queue.\n");
@@ -108,6 +136,18 @@ int consumer_producer_put(consumer_producer_t* queue, const char*item)
         fprintf(stderr, "Error: consumer_producer_put called on uninitialized queue.\n");
         return -1;
     }
+
+    // Copy outside the lock so other producers and the consumer are not held up
+    char* copy = malloc(len + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "Error: consumer_producer_put failed to copy item.\n");
+        return -1;
+    }
+    memcpy(copy, item, len);
+    copy[len] = '\0';
+    uint64_t now = stage_stats_now_ns();
+    uint64_t put_ns = now; // Before any wait for room - that wait is part of the item's latency
+
     pthread_mutex_lock(&queue->shared_mutex);
     
     while (queue->count == queue->capacity) {
@@ -116,16 +156,55 @@ int consumer_producer_put(consumer_producer_t* queue, const char*item)
         }
         monitor_wait(&queue->not_full_monitor, &queue->shared_mutex);
     }
+    if (warned) {
+        uint64_t waited_until = stage_stats_now_ns();
+        stage_counter_add(&queue->put_wait_ns, waited_until - now);
+        now = waited_until;
+    }
 
-    queue->items[queue->tail] = strdup(item); 
+    queue->meta[queue->tail].ingest_ns = thread_ingest_ns ? thread_ingest_ns : put_ns;
+    queue->meta[queue->tail].enqueue_ns = now;
+    queue->meta[queue->tail].trace_id = thread_trace_id;
+    queue->meta[queue->tail].flags = thread_flags;
+    queue->items[queue->tail] = copy; 
     queue->tail = (queue->tail + 1) % (queue->capacity); // Cicly 
     queue->count++;
+    int count = queue->count;
     monitor_signal(&queue->not_empty_monitor); 
     pthread_mutex_unlock(&queue->shared_mutex);
+    ANALYZER_PROBE2(queue_put_return, queue, count);
     return 0;
 }
 
 char* consumer_producer_get(consumer_producer_t* queue)
+{
+    return consumer_producer_get_meta(queue, NULL);
+}
+
+int consumer_producer_count(consumer_producer_t* queue)
+{
+    if (queue == NULL || queue->initialized == 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&queue->shared_mutex);
+    int count = queue->count;
+    pthread_mutex_unlock(&queue->shared_mutex);
+    return count;
+}
+
+void consumer_producer_set_thread_origin(uint64_t ingest_ns, uint32_t trace_id, uint32_t flags)
+{
+    thread_ingest_ns = ingest_ns;
+    thread_trace_id = trace_id;
+    thread_flags = flags;
+}
+
+uint32_t consumer_producer_thread_flags(void)
+{
+    return thread_flags;
+}
+
+char* consumer_producer_get_meta(consumer_producer_t* queue, queue_item_meta_t* meta)
 {
     int warned = 0; // Flag to track if we warned about empty queue
     char* item = NULL; // Initialize item to NULL, will be returned
@@ -139,27 +218,39 @@ char* consumer_producer_get(consumer_producer_t* queue)
         return NULL;
     }
 
+    ANALYZER_PROBE1(queue_get_entry, queue);
     // Critical part 
     pthread_mutex_lock(&queue->shared_mutex); 
+    uint64_t wait_start = 0;
     while (queue->count == 0 && !queue->finished) {
         if (!warned) {
             warned = 1; //the flag changing
+            wait_start = stage_stats_now_ns();
         }
         monitor_wait(&queue->not_empty_monitor, &queue->shared_mutex);
     }
+    if (warned) {
+        stage_counter_add(&queue->get_wait_ns, stage_stats_now_ns() - wait_start);
+    }
 
     if (queue->count == 0 && queue->finished) {// We stop waiting here and do not want te get an infinite loop
     pthread_mutex_unlock(&queue->shared_mutex);
+    ANALYZER_PROBE3(queue_get_return, queue, NULL, 0);
     return NULL;
     }
 
     
     item = queue->items[queue->head]; // Get the item
+    if (meta != NULL) {
+        *meta = queue->meta[queue->head];
+    }
     queue->head = (queue->head + 1) % (queue->capacity); // Cycle
     queue->count--;
+    int count = queue->count;
 
     monitor_signal(&queue->not_full_monitor); // Signal that the queue is not full for the producer
     pthread_mutex_unlock(&queue->shared_mutex);
+    ANALYZER_PROBE3(queue_get_return, queue, item, count);
 
     return item;
 }
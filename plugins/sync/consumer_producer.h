@@ -1,10 +1,24 @@
 #include "monitor.h"
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 
+// Timing carried with each queued item, next to its slot
+typedef struct
+{
+    uint64_t ingest_ns; // When the line the item came from entered the pipeline
+    uint64_t enqueue_ns; // When the item was put in this queue
+    uint32_t trace_id; // Trace id of that line, 0 if it is not traced (see stats/trace.h)
+    uint32_t flags; // QUEUE_ITEM_* bits
+} queue_item_meta_t;
+
+#define QUEUE_ITEM_CHUNK 0x1u // The item is a chunk of lines (see chunk/chunk.h), not one line
+
 typedef struct
 {
     char** items; //Array of string pointers 
+    queue_item_meta_t* meta; // Timing of each item, same indexes as items
     int capacity; // Maximum number of items 
     int count; // Current number of items 
     int head; // Index of first item 
@@ -15,6 +29,8 @@ typedef struct
     monitor_t not_full_monitor; //Monitor for "not full" state 
     monitor_t not_empty_monitor; // Monitor for "not empty" state
     monitor_t finished_monitor; // Monitor for finished signal 
+    uint64_t put_wait_ns; // Time producers spent blocked on a full queue (see stage_stats.h)
+    uint64_t get_wait_ns; // Time the consumer spent blocked on an empty queue
 } consumer_producer_t;
 
 // /**
@@ -38,6 +54,15 @@ void consumer_producer_destroy(consumer_producer_t* queue);
 // */
 int consumer_producer_put(consumer_producer_t* queue, const char* item);
 /**
+// * Same as consumer_producer_put for an item whose length is already known
+// * Copies exactly len bytes (plus a '\0'), so item need not be terminated
+// * @param queue Pointer to queue structure
+// * @param item Bytes to add (copied)
+// * @param len Number of bytes in item
+// * @return 0 on success, -1 on failure
+// */
+int consumer_producer_put_n(consumer_producer_t* queue, const char* item, size_t len);
+/**
 // * Remove an item from the queue (consumer) and returns it.
 // * Blocks if queue is empty.
 // * @param queue Pointer to queue structure
@@ -45,6 +70,41 @@ int consumer_producer_put(consumer_producer_t* queue, const char* item);
 // */
 char* consumer_producer_get(consumer_producer_t* queue);
 
+/**
+* Same as consumer_producer_get, also returning the item's timing
+* @param queue Pointer to queue structure
+* @param meta Set to the item's timing when an item is returned
+* @return String item or NULL if the queue is finished
+*/
+char* consumer_producer_get_meta(consumer_producer_t* queue, queue_item_meta_t* meta);
+
+/**
+* Number of items waiting in the queue right now
+* @param queue Pointer to queue structure
+* @return Item count, -1 if the queue is not initialized
+*/
+int consumer_producer_count(consumer_producer_t* queue);
+
+/**
+* Set the origin (ingest time, trace id and flags) of the items the calling
+* thread puts from now on
+* A stage's thread sets it to the origin of the item it processes, so the
+* results it forwards carry it on; the analyzer sets it to the time each
+* line was read. Threads that never set it stamp each item with the time
+* consumer_producer_put was called, before any wait for room
+* @param ingest_ns Ingest time, 0 to stamp items when they are put
+* @param trace_id Trace id, 0 for untraced items
+* @param flags QUEUE_ITEM_* bits of the items
+*/
+void consumer_producer_set_thread_origin(uint64_t ingest_ns, uint32_t trace_id, uint32_t flags);
+
+/**
+* Flags the calling thread last set with consumer_producer_set_thread_origin
+* For a stage's thread, those of the item it is processing
+* @return QUEUE_ITEM_* bits
+*/
+uint32_t consumer_producer_thread_flags(void);
+
 // /**
 // * Signal that processing is finished
 // * @param queue Pointer to queue structure
@@ -1,4 +1,5 @@
 #include "monitor.h"
+#include "../stats/probes.h"
 #include <stdio.h>
 
 int monitor_init(monitor_t* monitor)
@@ -65,7 +66,10 @@ int monitor_wait(monitor_t* monitor, pthread_mutex_t* shared_mutex)
         return -1; 
     }   
 
-    return pthread_cond_wait(&monitor->condition, shared_mutex);
+    ANALYZER_PROBE1(monitor_wait_entry, monitor);
+    int rc = pthread_cond_wait(&monitor->condition, shared_mutex);
+    ANALYZER_PROBE2(monitor_wait_return, monitor, rc);
+    return rc;
 }
 
 
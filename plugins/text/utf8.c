@@ -0,0 +1,103 @@
+#include "utf8.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+int utf8_mode_from_env(void)
+{
+    const char* mode = getenv(UTF8_MODE_ENV);
+    if (mode == NULL || *mode == '\0' || strcmp(mode, "utf8") == 0) {
+        return UTF8_MODE_CODEPOINTS;
+    }
+    if (strcmp(mode, "bytes") == 0) {
+        return UTF8_MODE_BYTES;
+    }
+    return -1;
+}
+
+size_t utf8_ascii_prefix(const char* s, size_t len)
+{
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // movemask collects the top bit of every byte - zero means the whole block is ASCII
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+        int mask = _mm_movemask_epi8(block);
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+#endif
+
+    for (; i < len; ++i) {
+        if ((unsigned char)s[i] >= 0x80) return i;
+    }
+    return len;
+}
+
+size_t utf8_count_codepoints(const char* s, size_t len)
+{
+    size_t continuation = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // As signed bytes, continuation bytes 0x80..0xBF are exactly the values below -64
+    const __m128i threshold = _mm_set1_epi8(-64);
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+        int mask = _mm_movemask_epi8(_mm_cmplt_epi8(block, threshold));
+        continuation += (size_t)__builtin_popcount((unsigned)mask);
+    }
+#endif
+
+    for (; i < len; ++i) {
+        if (((unsigned char)s[i] & 0xC0) == 0x80) continuation++;
+    }
+    return len - continuation;
+}
+
+int utf8_validate(const char* s, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)s;
+    size_t i = 0;
+
+    while (i < len) {
+        i += utf8_ascii_prefix(s + i, len - i);
+        if (i >= len) break;
+
+        unsigned char lead = p[i];
+        size_t need;
+        uint32_t cp;
+        uint32_t min;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            need = 1; cp = lead & 0x1F; min = 0x80;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            need = 2; cp = lead & 0x0F; min = 0x800;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            need = 3; cp = lead & 0x07; min = 0x10000;
+        } else {
+            return 0; // stray continuation byte, overlong 2-byte lead, or out of range
+        }
+
+        if (len - i <= need) return 0; // truncated sequence
+
+        for (size_t k = 1; k <= need; ++k) {
+            if ((p[i + k] & 0xC0) != 0x80) return 0;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return 0;
+        }
+        i += need + 1;
+    }
+
+    return 1;
+}
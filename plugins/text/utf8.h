@@ -0,0 +1,57 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+
+// Values returned by utf8_mode_from_env
+#define UTF8_MODE_BYTES 0 // Operate on raw bytes (the original behaviour)
+#define UTF8_MODE_CODEPOINTS 1 // Operate on codepoints, fall back to bytes for invalid UTF-8
+
+#define UTF8_MODE_ENV "PLUGIN_TEXT_MODE" // "utf8" (default) or "bytes"
+
+/**
+* Read the text mode for the text plugins from PLUGIN_TEXT_MODE
+* @return UTF8_MODE_CODEPOINTS, UTF8_MODE_BYTES, or -1 if the value is not recognized
+*/
+int utf8_mode_from_env(void);
+
+/**
+* Find the length of the leading pure-ASCII run (scans 16 bytes at a time)
+* @param s Input bytes
+* @param len Number of bytes in s
+* @return Offset of the first byte >= 0x80, or len if there is none
+*/
+size_t utf8_ascii_prefix(const char* s, size_t len);
+
+/**
+* Count codepoints, i.e. all bytes that are not continuation bytes (10xxxxxx)
+* Only meaningful for valid UTF-8
+* @param s Input bytes
+* @param len Number of bytes in s
+* @return Number of codepoints
+*/
+size_t utf8_count_codepoints(const char* s, size_t len);
+
+/**
+* Validate UTF-8 (no overlongs, surrogates or values above U+10FFFF)
+* ASCII blocks are skipped with the vector scan, only the rest is decoded
+* @param s Input bytes
+* @param len Number of bytes in s
+* @return 1 if valid, 0 otherwise
+*/
+int utf8_validate(const char* s, size_t len);
+
+/**
+* Length of the codepoint starting with the given lead byte (assumes valid UTF-8)
+* @param lead First byte of the codepoint
+* @return 1 to 4
+*/
+static inline size_t utf8_char_len(unsigned char lead)
+{
+    if (lead < 0x80) return 1;
+    if (lead < 0xE0) return 2;
+    if (lead < 0xF0) return 3;
+    return 4;
+}
+
+#endif // UTF8_H
@@ -4,38 +4,217 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <unistd.h> 
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
 
-static const char* plugin_transform(const char* input) {
-    if (input == NULL) return NULL;
+#define TYPEWRITER_DEFAULT_DELAY_US 100000 // 100ms delay for each character
+#define TYPEWRITER_DELAY_ENV "TYPEWRITER_DELAY_US" // 0 = print lines as soon as they arrive
 
-    size_t len = strlen(input);
-    if (len == 0) return strdup("");
+// The printer runs on its own thread so the stage never sleeps:
+// plugin_transform only appends the line to `pending` and forwards it,
+// and the printer writes one character per timerfd tick.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t has_work; // Signaled when pending grows or on drain
+    char* pending; // Characters accepted but not yet printed
+    size_t head; // Index of next character to print
+    size_t len; // Number of valid bytes in pending
+    size_t cap; // Allocated size of pending
+    long delay_us; // Per character delay, 0 disables pacing
+    int timer_fd; // Periodic tick while there is something to print
+    int draining; // Set by the fini hook - exit once pending is empty
+    int started; // Printer thread is running
+} typewriter_printer_t;
+
+static typewriter_printer_t printer = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .has_work = PTHREAD_COND_INITIALIZER,
+    .timer_fd = -1,
+};
+
+
+// Arm (or disarm, with delay 0) the periodic tick
+static int printer_set_timer(long delay_us) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_interval.tv_sec = delay_us / 1000000;
+    spec.it_interval.tv_nsec = (delay_us % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    return timerfd_settime(printer.timer_fd, 0, &spec, NULL);
+}
+
+static void* printer_thread(void* arg) {
+    (void)arg;
+    int armed = 0;
+
+    pthread_mutex_lock(&printer.mutex);
+    while (1) {
+        while (printer.head == printer.len && !printer.draining) {
+            if (armed) {
+                printer_set_timer(0);
+                armed = 0;
+            }
+            pthread_cond_wait(&printer.has_work, &printer.mutex);
+        }
+        if (printer.head == printer.len) {
+            break; // draining and nothing left
+        }
+
+        size_t to_print = printer.len - printer.head;
+        if (printer.delay_us > 0) {
+            if (!armed) {
+                printer_set_timer(printer.delay_us);
+                armed = 1;
+            }
+
+            // Wait for the next tick without holding the lock, so the stage can keep appending
+            uint64_t expirations = 0;
+            pthread_mutex_unlock(&printer.mutex);
+            ssize_t n = read(printer.timer_fd, &expirations, sizeof(expirations));
+            pthread_mutex_lock(&printer.mutex);
+            if (n != (ssize_t)sizeof(expirations)) {
+                if (n < 0 && errno == EINTR) continue;
+                expirations = to_print; // timer broken - do not stall the output
+            }
 
-    // Print "[typewriter] " with typewriter effect
-    const char* prefix = "[typewriter] ";
-    for (size_t i = 0; prefix[i] != '\0'; ++i) {
-        printf("%c", prefix[i]);
+            // A late wakeup prints every character that was due since the last tick
+            to_print = printer.len - printer.head;
+            if (expirations < to_print) {
+                to_print = (size_t)expirations;
+            }
+        }
+
+        fwrite(printer.pending + printer.head, 1, to_print, stdout);
         fflush(stdout);
-        usleep(100000);  // 100ms delay for each character in prefix
+        printer.head += to_print;
+
+        if (printer.head == printer.len) {
+            printer.head = 0;
+            printer.len = 0;
+        }
     }
+    pthread_mutex_unlock(&printer.mutex);
+    return NULL;
+}
 
-    // Print the input string with typewriter effect
-    for (size_t i = 0; i < len; ++i) {
-        printf("%c", input[i]);
-        fflush(stdout);
-        usleep(100000);  // 100ms delay for each character in input
+// Queue "[typewriter] <input>\n" for the printer
+static int printer_append(const char* input, size_t len) {
+    static const char prefix[] = "[typewriter] ";
+    size_t needed = (sizeof(prefix) - 1) + len + 1;
+
+    pthread_mutex_lock(&printer.mutex);
+    if (printer.head > 0 && printer.len + needed > printer.cap) {
+        // Reclaim the already printed part before growing
+        memmove(printer.pending, printer.pending + printer.head, printer.len - printer.head);
+        printer.len -= printer.head;
+        printer.head = 0;
+    }
+    if (printer.len + needed > printer.cap) {
+        size_t new_cap = printer.cap ? printer.cap : 256;
+        while (new_cap < printer.len + needed) new_cap *= 2;
+        char* grown = realloc(printer.pending, new_cap);
+        if (!grown) {
+            pthread_mutex_unlock(&printer.mutex);
+            return -1;
+        }
+        printer.pending = grown;
+        printer.cap = new_cap;
+    }
+
+    memcpy(printer.pending + printer.len, prefix, sizeof(prefix) - 1);
+    printer.len += sizeof(prefix) - 1;
+    memcpy(printer.pending + printer.len, input, len);
+    printer.len += len;
+    printer.pending[printer.len++] = '\n';
+
+    pthread_cond_signal(&printer.has_work);
+    pthread_mutex_unlock(&printer.mutex);
+    return 0;
+}
+
+// Runs from plugin_fini - let the printer finish the effect, then release it
+static void printer_drain(void) {
+    if (!printer.started) return;
+
+    pthread_mutex_lock(&printer.mutex);
+    printer.draining = 1;
+    pthread_cond_signal(&printer.has_work);
+    pthread_mutex_unlock(&printer.mutex);
+
+    pthread_join(printer.thread, NULL);
+    printer.started = 0;
+
+    close(printer.timer_fd);
+    printer.timer_fd = -1;
+    free(printer.pending);
+    printer.pending = NULL;
+    printer.head = printer.len = printer.cap = 0;
+}
+
+static const char* printer_start(void) {
+    long delay_us = TYPEWRITER_DEFAULT_DELAY_US;
+    const char* env = getenv(TYPEWRITER_DELAY_ENV);
+    if (env != NULL && *env != '\0') {
+        char* end = NULL;
+        errno = 0;
+        delay_us = strtol(env, &end, 10);
+        if (errno != 0 || *end != '\0' || delay_us < 0) {
+            return "invalid " TYPEWRITER_DELAY_ENV;
+        }
     }
 
-    printf("\n");  
-    fflush(stdout);
+    printer.delay_us = delay_us;
+    printer.draining = 0;
+    printer.head = printer.len = 0;
+
+    printer.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (printer.timer_fd < 0) {
+        return "timerfd_create failed";
+    }
+
+    if (pthread_create(&printer.thread, NULL, printer_thread, NULL) != 0) {
+        close(printer.timer_fd);
+        printer.timer_fd = -1;
+        return "pthread_create failed for printer";
+    }
+    printer.started = 1;
+    return NULL;
+}
+
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
+    if (input == NULL) return NULL;
+
+    size_t len = strlen(input);
+    if (len == 0) return strdup("");
 
-    return strdup(input);  
+    // Hand the visual effect to the printer and forward right away
+    if (printer_append(input, len) != 0) {
+        return NULL;
+    }
+
+    return strdup(input);
 }
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "typewriter", queue_size);
+    const char* error = printer_start();
+    if (error != NULL) {
+        return error;
+    }
+
+    error = common_plugin_init(plugin_transform, "typewriter", queue_size);
+    if (error != NULL) {
+        printer_drain();
+        return error;
+    }
+
+    common_plugin_set_fini_hook(printer_drain);
+    return NULL;
 }
 
 __attribute__((visibility("default")))
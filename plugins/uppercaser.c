@@ -8,7 +8,8 @@
 
 
 //Plugin logic
-static const char* plugin_transform(const char* input) {
+__attribute__((visibility("default")))
+const char* plugin_transform(const char* input) {
     if (input == NULL) return NULL;
 
     size_t len = strlen(input);
@@ -26,7 +27,7 @@ static const char* plugin_transform(const char* input) {
 
 __attribute__((visibility("default")))
 const char* plugin_init(int queue_size) {
-    return common_plugin_init(plugin_transform, "uppercaser", queue_size);
+    return common_plugin_init_ex(plugin_transform, "uppercaser", queue_size, PLUGIN_FLAG_PURE);
 }
 
 __attribute__((visibility("default")))
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../plugins/chunk/chunk.h"
+
+// gcc -o chunk_test chunk_test.c ../plugins/chunk/chunk.c
+
+void test_round_trip() {
+    printf("\n== Test: build and parse a chunk ==\n");
+
+    chunk_builder_t builder;
+    memset(&builder, 0, sizeof(builder));
+    assert(chunk_builder_add(&builder, "hello", 5) == 0);
+    assert(chunk_builder_add(&builder, "", 0) == 0);
+    assert(chunk_builder_add(&builder, "two\nlines", 9) == 0);
+
+    size_t len = 0;
+    char* msg = chunk_builder_finish(&builder, &len);
+    assert(msg != NULL && strlen(msg) == len);
+    assert(chunk_is_candidate(msg));
+    assert(builder.count == 0 && builder.len == 0);
+
+    chunk_view_t view;
+    memset(&view, 0, sizeof(view));
+    assert(chunk_parse(msg, len, &view) == 0);
+    assert(view.count == 3);
+    assert(view.lengths[0] == 5 && memcmp(msg + view.offsets[0], "hello", 5) == 0);
+    assert(view.lengths[1] == 0);
+    assert(view.lengths[2] == 9 && memcmp(msg + view.offsets[2], "two\nlines", 9) == 0);
+
+    free(msg);
+    chunk_view_destroy(&view);
+    chunk_builder_destroy(&builder);
+}
+
+void test_plain_lines_rejected() {
+    printf("\n== Test: ordinary lines do not parse as chunks ==\n");
+
+    chunk_view_t view;
+    memset(&view, 0, sizeof(view));
+    const char* samples[] = {
+        "hello", "", "\x1e", "\x1e" "2:1,1:ab" "c", "\x1e" "1:5:abc", "\x1e" "0::", "\x1e" "x:1:a",
+        "\x1e" "99999999999999999999999:1:a",
+    };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        assert(chunk_parse(samples[i], strlen(samples[i]), &view) == -1);
+    }
+    assert(chunk_parse("\x1e" "2:1,2:abc", 10, &view) == 0 && view.count == 2);
+    chunk_view_destroy(&view);
+}
+
+int main() {
+    printf("=== Starting Chunk Tests ===\n");
+    test_round_trip();
+    test_plain_lines_rejected();
+    printf("=== All Chunk Tests Passed ===\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../plugins/stats/latency_histogram.h"
+
+// gcc -o latency_histogram_test latency_histogram_test.c ../plugins/stats/latency_histogram.c
+
+static latency_histogram_t histogram;
+
+void test_small_values_exact() {
+    printf("\n== Test: values below 64 ns are exact ==\n");
+    memset(&histogram, 0, sizeof(histogram));
+    for (uint64_t v = 1; v <= 50; ++v) {
+        latency_histogram_record(&histogram, v);
+    }
+    assert(histogram.total == 50 && histogram.max == 50);
+    assert(latency_histogram_percentile(&histogram, 50) == 25);
+    assert(latency_histogram_percentile(&histogram, 100) == 50);
+    assert(latency_histogram_percentile(&histogram, 0) == 1);
+    printf("✓ percentiles of 1..50\n");
+}
+
+void test_relative_error() {
+    printf("\n== Test: large values within 1/32 ==\n");
+    uint64_t values[] = { 64, 100, 1000, 12345, 1000000, 987654321, 1ull << 40, UINT64_MAX };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        memset(&histogram, 0, sizeof(histogram));
+        latency_histogram_record(&histogram, values[i]);
+        latency_histogram_record(&histogram, 1); // so the answer is not just the max
+        uint64_t p100 = latency_histogram_percentile(&histogram, 100);
+        assert(p100 == values[i]);
+        uint64_t p75 = latency_histogram_percentile(&histogram, 75);
+        assert(p75 <= values[i] && p75 >= values[i] - values[i] / 32);
+    }
+    printf("✓ bucket bounds\n");
+}
+
+void test_tail() {
+    printf("\n== Test: p99 and p99.9 of a skewed distribution ==\n");
+    memset(&histogram, 0, sizeof(histogram));
+    for (int i = 0; i < 9990; ++i) latency_histogram_record(&histogram, 1000);
+    for (int i = 0; i < 9; ++i) latency_histogram_record(&histogram, 50000);
+    latency_histogram_record(&histogram, 2000000);
+
+    uint64_t p50 = latency_histogram_percentile(&histogram, 50);
+    uint64_t p999 = latency_histogram_percentile(&histogram, 99.9);
+    assert(p50 >= 1000 && p50 < 1000 + 1000 / 32);
+    assert(latency_histogram_percentile(&histogram, 99) == p50);
+    assert(p999 >= 1000 && p999 < 1000 + 1000 / 32);
+    assert(latency_histogram_percentile(&histogram, 99.95) >= 50000 - 50000 / 32);
+    assert(latency_histogram_percentile(&histogram, 100) == 2000000);
+
+    latency_histogram_t copy;
+    latency_histogram_snapshot(&copy, &histogram);
+    assert(copy.total == 10000 && copy.max == 2000000);
+    printf("✓ tail percentiles\n");
+}
+
+void test_cumulative() {
+    printf("\n== Test: cumulative counts and sum ==\n");
+    memset(&histogram, 0, sizeof(histogram));
+    for (uint64_t v = 1; v <= 10; ++v) latency_histogram_record(&histogram, v);
+    for (int i = 0; i < 10; ++i) latency_histogram_record(&histogram, 1000000);
+    assert(latency_histogram_count_at_most(&histogram, 0) == 0);
+    assert(latency_histogram_count_at_most(&histogram, 5) == 5);
+    assert(latency_histogram_count_at_most(&histogram, 999) == 10);
+    assert(latency_histogram_count_at_most(&histogram, 1000000) == 20);
+    assert(latency_histogram_count_at_most(&histogram, UINT64_MAX) == 20);
+
+    double sum = latency_histogram_sum(&histogram);
+    double exact = 55 + 10 * 1000000.0;
+    assert(sum >= exact - exact / 64 && sum <= exact + exact / 64);
+    printf("✓ le counts and sum\n");
+}
+
+int main() {
+    printf("=== Starting Latency Histogram Tests ===\n");
+    test_small_values_exact();
+    test_relative_error();
+    test_tail();
+    test_cumulative();
+    printf("=== All Latency Histogram Tests Passed ===\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../plugins/cache/transform_cache.h"
+
+// gcc -o transform_cache_test transform_cache_test.c ../plugins/cache/transform_cache.c
+
+static void put(transform_cache_t* cache, const char* in, const char* out) {
+    transform_cache_insert(cache, transform_cache_hash(in, strlen(in)), in, strlen(in), out, strlen(out));
+}
+
+static const char* get(transform_cache_t* cache, const char* in) {
+    return transform_cache_lookup(cache, transform_cache_hash(in, strlen(in)), in, strlen(in), NULL);
+}
+
+void test_hit_and_miss() {
+    printf("\n== Test: lookup hit and miss ==\n");
+
+    transform_cache_t cache;
+    assert(transform_cache_init(&cache, 1 << 20) == 0);
+
+    assert(get(&cache, "hello") == NULL);
+    put(&cache, "hello", "HELLO");
+    assert(strcmp(get(&cache, "hello"), "HELLO") == 0);
+    assert(get(&cache, "hell") == NULL);
+    assert(cache.hits == 1 && cache.misses == 2);
+
+    transform_cache_destroy(&cache);
+}
+
+void test_budget_eviction() {
+    printf("\n== Test: byte budget and CLOCK eviction ==\n");
+
+    // Room for only a few small entries
+    transform_cache_t cache;
+    assert(transform_cache_init(&cache, 4 * (sizeof(transform_cache_entry_t) + sizeof(int) + 8)) == 0);
+
+    put(&cache, "a1", "A1");
+    put(&cache, "b1", "B1");
+    put(&cache, "c1", "C1");
+    put(&cache, "d1", "D1");
+    assert(cache.evictions == 0);
+
+    // Referenced entry survives the next sweep
+    assert(get(&cache, "a1") != NULL);
+    put(&cache, "e1", "E1");
+    assert(cache.evictions == 1);
+    assert(cache.used <= cache.budget);
+    assert(get(&cache, "a1") != NULL);
+    assert(get(&cache, "b1") == NULL);
+    assert(get(&cache, "e1") != NULL);
+
+    // Larger than the whole budget is never stored
+    char big[1024];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    assert(transform_cache_insert(&cache, 1, big, strlen(big), big, strlen(big)) == -1);
+
+    transform_cache_destroy(&cache);
+}
+
+void test_many_entries() {
+    printf("\n== Test: bucket growth ==\n");
+
+    transform_cache_t cache;
+    assert(transform_cache_init(&cache, 1 << 24) == 0);
+
+    char key[32];
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(key, sizeof(key), "line-%d", i);
+        put(&cache, key, key);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(key, sizeof(key), "line-%d", i);
+        assert(strcmp(get(&cache, key), key) == 0);
+    }
+    assert(cache.bucket_count >= cache.live_count);
+
+    transform_cache_clear(&cache);
+    assert(get(&cache, "line-1") == NULL);
+    transform_cache_destroy(&cache);
+}
+
+int main() {
+    printf("=== Starting Transform Cache Tests ===\n");
+    test_hit_and_miss();
+    test_budget_eviction();
+    test_many_entries();
+    printf("=== All Transform Cache Tests Passed ===\n");
+    return 0;
+}
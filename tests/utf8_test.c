@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "../plugins/text/utf8.h"
+
+// gcc -o utf8_test utf8_test.c ../plugins/text/utf8.c
+
+void test_ascii_prefix() {
+    printf("\n== Test: utf8_ascii_prefix ==\n");
+
+    assert(utf8_ascii_prefix("", 0) == 0);
+    assert(utf8_ascii_prefix("hello", 5) == 5);
+
+    // Non-ASCII byte inside and after a full 16 byte block
+    const char* s = "0123456789abcdef0123\xc3\xa9";
+    assert(utf8_ascii_prefix(s, strlen(s)) == 20);
+    assert(utf8_ascii_prefix("\xc3\xa9", 2) == 0);
+}
+
+void test_count_codepoints() {
+    printf("\n== Test: utf8_count_codepoints ==\n");
+
+    assert(utf8_count_codepoints("abc", 3) == 3);
+    assert(utf8_count_codepoints("h\xc3\xa9llo", 6) == 5);
+
+    // 20 x U+00E9 crosses the vector block boundary
+    char buf[64] = "";
+    for (int i = 0; i < 20; ++i) strcat(buf, "\xc3\xa9");
+    assert(utf8_count_codepoints(buf, strlen(buf)) == 20);
+}
+
+void test_validate() {
+    printf("\n== Test: utf8_validate ==\n");
+
+    assert(utf8_validate("plain ascii", 11) == 1);
+    assert(utf8_validate("h\xc3\xa9llo", 6) == 1);
+    assert(utf8_validate("\xe2\x82\xac", 3) == 1); // U+20AC
+    assert(utf8_validate("\xf0\x9f\x98\x80", 4) == 1); // U+1F600
+
+    assert(utf8_validate("\x80", 1) == 0); // stray continuation
+    assert(utf8_validate("\xc3", 1) == 0); // truncated
+    assert(utf8_validate("\xc0\xaf", 2) == 0); // overlong
+    assert(utf8_validate("\xe0\x80\xaf", 3) == 0); // overlong
+    assert(utf8_validate("\xed\xa0\x80", 3) == 0); // surrogate
+    assert(utf8_validate("\xf4\x90\x80\x80", 4) == 0); // above U+10FFFF
+}
+
+int main() {
+    printf("=== Starting UTF-8 Tests ===\n");
+    test_ascii_prefix();
+    test_count_codepoints();
+    test_validate();
+    printf("=== All UTF-8 Tests Passed ===\n");
+    return 0;
+}